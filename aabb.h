@@ -0,0 +1,49 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "rtmath.h"
+
+/** Axis-aligned bounding box, one interval per axis. */
+class aabb {
+    public:
+        interval x, y, z;
+
+        aabb() {}   // Empty: the intervals are empty by default
+
+        aabb(const interval& x, const interval& y, const interval& z) : x(x), y(y), z(z) {}
+
+        /** The box with corners a and b, in any order. */
+        aabb(const point3& a, const point3& b)
+            : x(std::fmin(a[0], b[0]), std::fmax(a[0], b[0])),
+              y(std::fmin(a[1], b[1]), std::fmax(a[1], b[1])),
+              z(std::fmin(a[2], b[2]), std::fmax(a[2], b[2])) {}
+
+        /** Smallest box around both boxes. */
+        aabb(const aabb& a, const aabb& b)
+            : x(std::fmin(a.x.min, b.x.min), std::fmax(a.x.max, b.x.max)),
+              y(std::fmin(a.y.min, b.y.min), std::fmax(a.y.max, b.y.max)),
+              z(std::fmin(a.z.min, b.z.min), std::fmax(a.z.max, b.z.max)) {}
+
+        const interval& axis_interval(int n) const {
+            if (n == 1) return y;
+            if (n == 2) return z;
+            return x;
+        }
+
+        bool is_empty() const { return x.min > x.max || y.min > y.max || z.min > z.max; }
+
+        /** False for boxes reaching to infinity, e.g. the default hittable::bounding_box(). */
+        bool is_finite() const {
+            return std::isfinite(x.min) && std::isfinite(x.max) && std::isfinite(y.min)
+                && std::isfinite(y.max) && std::isfinite(z.min) && std::isfinite(z.max);
+        }
+
+        vec3 diagonal() const { return vec3(x.size(), y.size(), z.size()); }
+
+        static const aabb empty, universe;
+};
+
+const aabb aabb::empty = aabb(interval::empty, interval::empty, interval::empty);
+const aabb aabb::universe = aabb(interval::universe, interval::universe, interval::universe);
+
+#endif
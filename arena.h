@@ -0,0 +1,84 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "rtmath.h"
+
+/**
+ * Bulk allocator for scene objects. Objects are placed in large typed chunks and handed
+ * out as shared_ptrs that alias one shared owner, so building millions of objects costs
+ * a few chunk allocations instead of one make_shared (allocation + control block) each.
+ *
+ * The chunks live until the arena and every pointer it handed out are gone, so a world
+ * can simply keep the objects after the arena itself goes out of scope.
+ */
+class scene_arena {
+    public:
+        scene_arena() : storage(std::make_shared<chunks>()) {}
+
+        template <typename T, typename... Args>
+        shared_ptr<T> make(Args&&... args) {
+            T* object = storage->pool_for<T>().construct(std::forward<Args>(args)...);
+            return shared_ptr<T>(storage, object);
+        }
+
+    private:
+        struct pool_base {
+            virtual ~pool_base() = default;
+            virtual const std::type_info& type() const = 0;
+        };
+
+        template <typename T>
+        struct typed_pool : pool_base {
+            static const size_t chunk_objects = 4096;
+
+            std::vector<T*> chunk_list;
+            size_t used_in_last = chunk_objects;
+
+            ~typed_pool() override {
+                for (size_t c = 0; c < chunk_list.size(); c++) {
+                    size_t count = (c + 1 == chunk_list.size()) ? used_in_last : chunk_objects;
+                    for (size_t k = 0; k < count; k++)
+                        chunk_list[c][k].~T();
+                    ::operator delete(chunk_list[c], std::align_val_t(alignof(T)));
+                }
+            }
+
+            const std::type_info& type() const override { return typeid(T); }
+
+            template <typename... Args>
+            T* construct(Args&&... args) {
+                if (used_in_last == chunk_objects) {
+                    chunk_list.push_back(static_cast<T*>(
+                        ::operator new(sizeof(T) * chunk_objects, std::align_val_t(alignof(T)))));
+                    used_in_last = 0;
+                }
+                T* slot = chunk_list.back() + used_in_last;
+                new (slot) T(std::forward<Args>(args)...);
+                used_in_last++;
+                return slot;
+            }
+        };
+
+        struct chunks {
+            std::vector<std::unique_ptr<pool_base>> pools;
+
+            template <typename T>
+            typed_pool<T>& pool_for() {
+                for (auto& pool : pools)
+                    if (pool->type() == typeid(T)) return static_cast<typed_pool<T>&>(*pool);
+                pools.push_back(std::make_unique<typed_pool<T>>());
+                return static_cast<typed_pool<T>&>(*pools.back());
+            }
+        };
+
+        shared_ptr<chunks> storage;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <string>
+
+#include <unistd.h>
+
+#include "render_service.h"
+#include "scene_gen.h"
+#include "uniform_grid.h"
+
+/**
+ * Scaling benchmark over the procedural stress scenes. For object counts 10^3, 10^4, ... up
+ * to max_count and thread counts 1, 2, 4, ... up to max_threads it prints one CSV row:
+ * build time, accelerator build time on that many threads, render time, and resident
+ * memory of the built scene.
+ *
+ * Usage: bench_scaling <sphere_field|triangle_soup|ground_clutter|hall_of_mirrors>
+ *                      [max_count=100000] [max_threads=hardware] [image_width=160] [seed=1]
+ *                      [accelerator=none|grid]
+ *
+ * With "policies" first it instead renders one scene under each camera termination policy
+ * and prints the rays each traced, the share saved against the plain depth limit, and how
+ * many 8-bit output values came out different from it:
+ *
+ *        bench_scaling policies <scene> [count=1000] [max_depth=8] [image_width=160] [seed=1]
+ */
+
+/** Resident set size in MB, from /proc (Linux). */
+double resident_mb() {
+    std::ifstream statm("/proc/self/statm");
+    long pages_total = 0, pages_resident = 0;
+    statm >> pages_total >> pages_resident;
+    return double(pages_resident) * double(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+}
+
+double milliseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::function<stress_scene(long, std::uint64_t)> scene_generator(const std::string& kind) {
+    if (kind == "sphere_field") return sphere_field;
+    if (kind == "triangle_soup") return triangle_soup;
+    if (kind == "ground_clutter") return ground_clutter;
+    if (kind == "hall_of_mirrors") return hall_of_mirrors;
+    std::cerr << "Error: unknown scene " << kind << ".\n";
+    return nullptr;
+}
+
+int compare_policies(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " policies <scene> [count] [max_depth] [image_width] [seed]\n";
+        return 1;
+    }
+
+    std::string kind = argv[2];
+    long count = argc > 3 ? std::atol(argv[3]) : 1000;
+    int max_depth = argc > 4 ? std::atoi(argv[4]) : 8;
+    int image_width = argc > 5 ? std::atoi(argv[5]) : 160;
+    std::uint64_t seed = argc > 6 ? std::strtoull(argv[6], nullptr, 10) : 1;
+
+    auto generate = scene_generator(kind);
+    if (!generate) return 1;
+    auto scene = make_shared<stress_scene>(generate(count, seed));
+    shared_ptr<const hittable_list> world(scene, &scene->world);
+    render_service service(resolve_thread_count(0));
+
+    const std::pair<termination_policy, const char*> policies[] = {
+        {termination_policy::depth, "depth"},
+        {termination_policy::output_cutoff, "output_cutoff"},
+        {termination_policy::russian_roulette, "russian_roulette"}};
+
+    std::cout << "scene,objects,policy,max_depth,rays,rays_saved_pct,render_ms,changed_values\n";
+    long long depth_rays = 0;
+    rgb8_image reference;
+    for (const auto& [policy, name] : policies) {
+        render_stats stats;
+        camera cam = scene->cam;
+        cam.image_width = image_width;
+        cam.max_depth = max_depth;
+        cam.termination = policy;
+        cam.stats = &stats;
+
+        auto render_start = std::chrono::steady_clock::now();
+        rgb8_image image = service.submit(world, cam).get()->quantize();
+        double render_ms = milliseconds_since(render_start);
+
+        if (policy == termination_policy::depth) {
+            depth_rays = stats.segments;
+            reference = image;
+        }
+        long changed = 0;
+        for (size_t k = 0; k < image.pixels.size(); k++)
+            if (image.pixels[k] != reference.pixels[k]) changed++;
+
+        std::cout << kind << ',' << scene->world.objects.size() << ',' << name << ',' << max_depth << ','
+                  << stats.segments << ',' << 100.0 * double(depth_rays - stats.segments) / double(depth_rays) << ','
+                  << render_ms << ',' << changed << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "policies") return compare_policies(argc, argv);
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <sphere_field|triangle_soup|ground_clutter|hall_of_mirrors>"
+                  << " [max_count] [max_threads] [image_width] [seed] [none|grid]\n";
+        return 1;
+    }
+
+    std::string kind = argv[1];
+    long max_count = argc > 2 ? std::atol(argv[2]) : 100000;
+    int max_threads = argc > 3 ? std::atoi(argv[3]) : resolve_thread_count(0);
+    int image_width = argc > 4 ? std::atoi(argv[4]) : 160;
+    std::uint64_t seed = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 1;
+    std::string accelerator = argc > 6 ? argv[6] : "none";
+
+    auto generate = scene_generator(kind);
+    if (!generate) return 1;
+    if (accelerator != "none" && accelerator != "grid") {
+        std::cerr << "Error: unknown accelerator " << accelerator << ".\n";
+        return 1;
+    }
+
+    std::cout << "scene,objects,threads,build_ms,accel_ms,render_ms,scene_mb\n";
+    for (long count = 1000; count <= max_count; count *= 10) {
+        double memory_before = resident_mb();
+        auto build_start = std::chrono::steady_clock::now();
+        auto scene = make_shared<stress_scene>(generate(count, seed));
+        double build_ms = milliseconds_since(build_start);
+        double scene_mb = resident_mb() - memory_before;
+
+        scene->cam.image_width = image_width;
+        shared_ptr<const hittable_list> world(scene, &scene->world);
+
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            double accel_ms = 0;
+            if (accelerator == "grid") {
+                scene->world.set_accelerator(nullptr);
+                grid_options options;
+                options.threads = threads;
+                auto accel_start = std::chrono::steady_clock::now();
+                scene->world.set_accelerator(make_shared<uniform_grid>(scene->world.objects, options));
+                accel_ms = milliseconds_since(accel_start);
+            }
+
+            render_service service(threads);
+            auto render_start = std::chrono::steady_clock::now();
+            service.submit(world, scene->cam).get();
+            double render_ms = milliseconds_since(render_start);
+
+            std::cout << kind << ',' << scene->world.objects.size() << ',' << threads << ','
+                      << build_ms << ',' << accel_ms << ',' << render_ms << ',' << scene_mb << std::endl;
+        }
+    }
+}
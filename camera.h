@@ -1,10 +1,36 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
+#include <vector>
 
+#include "framebuffer.h"
+#include "frustum.h"
 #include "hittable.h"
 #include "hittable_list.h"
+#include "tile.h"
+
+/** When camera::ray_color stops following reflections. */
+enum class termination_policy {
+    depth,              // Follow reflections to max_depth, or until their weight drops below 1e-8
+    output_cutoff,      // Also stop once the rest of the path can't change the quantized output;
+                        // acts as depth with more than one sample per pixel, where averaging
+                        // could still carry a pixel across a quantization step
+    russian_roulette    // Also stop at random, weighting survivors up so the mean is unchanged
+};
+
+/** Most bits per channel output_cutoff can be asked to preserve. */
+const int max_output_bits = 16;
+
+/** Path counters a camera adds to while rendering, if given one. */
+struct render_stats {
+    std::atomic<long long> paths{0};      // Camera rays traced
+    std::atomic<long long> segments{0};   // Rays cast along those paths, reflections included
+};
 
 class camera {
     public:
@@ -14,8 +40,17 @@ class camera {
         point3 look_at;             // Camera target
         vec3 look_up;               // 'up' direction
         double vfov;                // vertical field of view (degrees)
+        int    samples_per_pixel = 1;  // Rays traced per pixel, averaged
+        bool   verbose = true;         // Print progress and warnings
+
+        int    max_depth = 3;          // Most rays cast per path, the camera ray included
+        termination_policy termination = termination_policy::depth;
+        int    output_bits = 8;        // output_cutoff: bits per channel of the final image, 1 to max_output_bits
+        int    roulette_depth = 1;     // russian_roulette: rays cast before the roulette starts
+        render_stats* stats = nullptr; // Counts traced paths and rays when set
 
-        void render(const hittable_list& world, const std::string& filename) {
+        /** Renders to a P3 file. If aux is given it also receives the denoiser's guide buffers. */
+        void render(const hittable_list& world, const std::string& filename, aux_buffers* aux = nullptr) {
             std::ofstream output_file(filename, std::ios::out | std::ios::trunc);
 
             if (!output_file) {
@@ -26,36 +61,158 @@ class camera {
             initialize();
 
             output_file << "P3\n" << image_width << ' ' << image_height << "\n255\n";
+            if (aux) {
+                *aux = aux_buffers(image_width, image_height);
+                aux->samples = samples_per_pixel;
+            }
 
             for (int j = 0; j < image_height; j++) {
-                std::clog << "\rScanlines remaining: " << (image_height - j) << ' ' << std::flush;
-                for (int i = 0; i < image_width; i++) {
-                    auto pixel_center = pixel00_loc + (i * pixel_delta_u) + (j * pixel_delta_v);
-                    auto ray_direction = pixel_center - look_from;
-                    ray r(look_from, ray_direction);
-
-                    color pixel_color = ray_color(r, world);
-                    write_color(output_file, pixel_color);
-                }
+                if (verbose)
+                    std::clog << "\rScanlines remaining: " << (image_height - j) << ' ' << std::flush;
+                for (int i = 0; i < image_width; i++)
+                    write_color(output_file, pixel_color(world, i, j, nullptr, aux));
             }
 
-            std::clog << "\rDone.                 \n";
+            if (verbose) std::clog << "\rDone.                 \n";
             output_file.close();
         }
 
-    private:
-        int    image_height;   // Rendered image height
-        point3 pixel00_loc;    // Location of pixel [0, 0]
-        vec3   pixel_delta_u;  // Offset to pixel to the right
-        vec3   pixel_delta_v;  // Offset to pixel below
+        /**
+         * Renders the pixels of one tile into image, and their guide buffers into aux if given
+         * (sized to the image, with samples set). Requires initialize().
+         */
+        void render_tile(const hittable_list& world, framebuffer& image, const tile& t,
+                         aux_buffers* aux = nullptr) const {
+            std::vector<const hittable*> candidates;
+            const auto* primary = primary_candidates(world, t, candidates) ? &candidates : nullptr;
+            for (int j = t.y0; j < t.y1; j++)
+                for (int i = t.x0; i < t.x1; i++)
+                    image.at(i, j) = pixel_color(world, i, j, primary, aux);
+        }
+
+        /**
+         * Fills candidates with the objects of world, in world order, that camera rays of
+         * tile t could hit: those whose bounding boxes touch the tile's frustum. Testing only
+         * those gives the same first hits as testing the whole world, for a cost that follows
+         * what the tile sees rather than the scene size. Returns false, leaving candidates
+         * empty, if world has an accelerator, which already skips what rays can't reach.
+         * Requires initialize().
+         */
+        bool primary_candidates(const hittable_list& world, const tile& t, std::vector<const hittable*>& candidates) const {
+            candidates.clear();
+            if (world.get_accelerator()) return false;
+
+            // Sample rays stay within their pixel; the tiny margin absorbs rounding
+            const double margin = 1e-3;
+            double left = t.x0 - 0.5 - margin, right = t.x1 - 0.5 + margin;
+            double top = t.y0 - 0.5 - margin, bottom = t.y1 - 0.5 + margin;
+            point3 corners[4] = {
+                pixel00_loc + left * pixel_delta_u + top * pixel_delta_v,
+                pixel00_loc + right * pixel_delta_u + top * pixel_delta_v,
+                pixel00_loc + right * pixel_delta_u + bottom * pixel_delta_v,
+                pixel00_loc + left * pixel_delta_u + bottom * pixel_delta_v};
+            frustum view(look_from, corners);
+
+            for (const auto& object : world.objects)
+                if (view.may_contain(object->bounding_box())) candidates.push_back(object.get());
+            return true;
+        }
+
+        /**
+         * Averages all samples of pixel (i, j). primary, if given, lists the objects the camera
+         * rays may hit (see primary_candidates); reflections and shadows always test the whole
+         * world. If aux is given, the pixel's guides are recorded from the first hits of those
+         * same samples, along with how much the samples disagree. Requires initialize().
+         */
+        color pixel_color(const hittable_list& world, int i, int j,
+                          const std::vector<const hittable*>* primary = nullptr,
+                          aux_buffers* aux = nullptr) const {
+            color sum = color(0, 0, 0);
+            if (!aux) {
+                for (int s = 0; s < samples_per_pixel; s++)
+                    sum += sample_color(world, i, j, s, primary);
+                return sum / samples_per_pixel;
+            }
 
+            color sum_squares(0, 0, 0);
+            vec3 normal(0, 0, 0);
+            color albedo(0, 0, 0);
+            double depth = 0;
+            int hits = 0, same_surface = 0;
+            bool random = false;
+            vec3 center_normal(0, 0, 0);
+            size_t k = aux->index(i, j);
+            for (int s = 0; s < samples_per_pixel; s++) {
+                ray r = sample_ray(i, j, s);
+                path_record path;
+                color sample = ray_color(r, world, path_seed(i, j, s), primary, &path);
+                const hit_record& first = path.first_hit;
+                random = random || path.random;
+                sum += sample;
+                sum_squares += sample * sample;
+                if (first.mat) {
+                    normal += first.normal;
+                    albedo += first.mat->diffuse_color;
+                    depth += first.t * r.direction().length();
+                    hits++;
+                } else {
+                    albedo += world.get_background_color();
+                }
+                if (s == 0) {
+                    aux->material_id[k] = first.mat.get();
+                    center_normal = first.normal;
+                }
+                // Another object of the same material shows as a jump in the normal
+                if (first.mat.get() == aux->material_id[k] && (!first.mat || dot(first.normal, center_normal) > 0.9))
+                    same_surface++;
+            }
+
+            int n = samples_per_pixel;
+            color mean = sum / n;
+            aux->normal[k] = normal / n;
+            aux->albedo[k] = albedo / n;
+            aux->depth[k] = hits > 0 ? depth / hits : infinity;
+            aux->coverage[k] = double(same_surface) / n;
+            aux->random[k] = random;
+            // Unbiased estimate of the variance of mean, summed over the channels
+            color spread = sum_squares / n - mean * mean;
+            aux->variance[k] = n > 1 ? std::max(0.0, spread.x() + spread.y() + spread.z()) / (n - 1) : 0;
+            return mean;
+        }
+
+        /** 
+         * Traces sample s of pixel (i, j). Sample 0 goes through the pixel center, the rest 
+         * are spread over the pixel with the R2 low-discrepancy sequence, so every sample is 
+         * reproducible no matter which order (or which thread) renders it. Requires initialize().
+         */
+        color sample_color(const hittable_list& world, int i, int j, int s,
+                           const std::vector<const hittable*>* primary = nullptr) const {
+            return ray_color(sample_ray(i, j, s), world, path_seed(i, j, s), primary);
+        }
+
+        /** The camera ray of sample s of pixel (i, j). Requires initialize(). */
+        ray sample_ray(int i, int j, int s) const {
+            auto pixel_center = pixel00_loc + (i * pixel_delta_u) + (j * pixel_delta_v);
+            if (s > 0) {
+                double du = std::fmod(0.5 + 0.7548776662466927 * s, 1.0) - 0.5;
+                double dv = std::fmod(0.5 + 0.5698402909980532 * s, 1.0) - 0.5;
+                pixel_center += du * pixel_delta_u + dv * pixel_delta_v;
+            }
+            auto ray_direction = pixel_center - look_from;
+            return ray(look_from, ray_direction);
+        }
+
+        int get_image_height() const { return image_height; }
+
+        /** Derives the image height and viewport from the public settings. render() calls this itself. */
         void initialize() {
             image_height = int(image_width / aspect_ratio);
             image_height = (image_height < 1) ? 1 : image_height;
 
             /** Ensure valid directions */
             if (fabs(dot(unit_vector(look_up), unit_vector(look_from - look_at))) > 0.9999) {
-                std::cerr << "Warning: Look Up is almost parallel to Look From - Look At, readjusting.\n";
+                if (verbose)
+                    std::cerr << "Warning: Look Up is almost parallel to Look From - Look At, readjusting.\n";
                 look_up = vec3(0, 1, 0);                // This should be a safe vector... right?
             }
 
@@ -84,10 +241,62 @@ class camera {
             pixel00_loc = viewport_upper_left + 0.5 * (pixel_delta_u + pixel_delta_v);
         }
 
-        color ray_color(const ray& r, const hittable_list& world) const {
+    private:
+        int    image_height;   // Rendered image height
+        point3 pixel00_loc;    // Location of pixel [0, 0]
+        vec3   pixel_delta_u;  // Offset to pixel to the right
+        vec3   pixel_delta_v;  // Offset to pixel below
+
+        /** Seed for the random choices along the path of sample s of pixel (i, j). */
+        static std::uint64_t path_seed(int i, int j, int s) {
+            return (std::uint64_t(std::uint32_t(j)) << 40) ^ (std::uint64_t(std::uint32_t(i)) << 20) ^ std::uint64_t(s);
+        }
+
+        /** Uniform in [0, 1), fixed by the path seed and the bounce (splitmix64 finalizer). */
+        static double path_random(std::uint64_t seed, int bounce) {
+            std::uint64_t z = seed * 0x9e3779b97f4a7c15ull + std::uint64_t(bounce + 1) * 0xd1b54a32d192ed03ull;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            z ^= z >> 31;
+            return double(z >> 11) * 0x1.0p-53;
+        }
+
+        /**
+         * True if the rays_left further rays of a path, each adding at most weight times the
+         * brightest possible local color, can't move any channel of final_color across an
+         * output quantization step. Local colors are clamped to 1 and only the background can
+         * be brighter. Assumes reflection factors of at most 1, so weight only falls. With one
+         * sample per pixel this leaves every output value exactly as a full trace would.
+         */
+        bool contribution_settled(const color& final_color, double weight, int rays_left,
+                                  const hittable_list& world) const {
+            const color& background = world.get_background_color();
+            double brightest = std::max({1.0, background.x(), background.y(), background.z()});
+            // The slack covers rounding in the products and sums still to come
+            double bound = weight * brightest * rays_left * (1 + 1e-9) + 1e-12;
+            int bits = std::clamp(output_bits, 1, max_output_bits);
+            double scale = double((1 << bits) - 1) + 0.999;  // 255.999 for 8 bits, like write_color
+            const double margin = 1e-9;
+            for (int c = 0; c < 3; c++) {
+                double low = std::max(0.0, final_color[c] - margin);
+                if (std::floor(scale * low) != std::floor(scale * (final_color[c] + bound + margin)))
+                    return false;
+            }
+            return true;
+        }
+
+        /** What ray_color saw of a path besides its color. */
+        struct path_record {
+            hit_record first_hit;   // The camera ray's hit; mat stays null on a miss
+            bool random = false;    // russian_roulette made a choice that could change the color
+        };
+
+        /** Color seen along r, and if path is given what else the path saw. */
+        color ray_color(const ray& r, const hittable_list& world, std::uint64_t seed,
+                        const std::vector<const hittable*>* primary = nullptr,
+                        path_record* path = nullptr) const {
             hit_record rec;
             ray current_ray = r;
-            int max_depth = 3;  // Maximum reflections
             const double epsilon = 1e-8; // Minimum reflection contribution
 
             /** Apparently the bias needed to prevent 'shadow acne', 
@@ -97,10 +306,16 @@ class camera {
             
             color final_color = color(0, 0, 0); // Accumulated color
             double reflection_factor = 1.0; // Initialize reflection at full strength
+            int rays_cast = 0;
 
             /** Do this in a loop for multiple reflections, since recursion is slow */
             for (int i = 0; i < max_depth; i++) {
-                if (world.hit(current_ray, interval(0, infinity), rec)) {
+                rays_cast++;
+                bool hit_something = (i == 0 && primary)
+                                   ? hit_closest(*primary, current_ray, interval(0, infinity), rec)
+                                   : world.hit(current_ray, interval(0, infinity), rec);
+                if (hit_something && i == 0 && path) path->first_hit = rec;
+                if (hit_something) {
                     color local_color = color(0, 0, 0); // Reset local color each bounce
 
                     if (world.is_shadowed(rec.p, world.get_light_direction())) {
@@ -130,6 +345,18 @@ class camera {
                     // Stop if reflections are insignificant
                     if (reflection_factor < epsilon) break;
 
+                    if (termination == termination_policy::output_cutoff && samples_per_pixel == 1
+                        && contribution_settled(final_color, reflection_factor, max_depth - i - 1, world))
+                        break;
+
+                    if (termination == termination_policy::russian_roulette && i + 1 >= roulette_depth) {
+                        // Survive in proportion to the path's weight, then make up for the dropped paths
+                        double survival = std::min(1.0, reflection_factor);
+                        if (path && survival < 1 && i + 1 < max_depth) path->random = true;
+                        if (path_random(seed, i) >= survival) break;
+                        reflection_factor /= survival;
+                    }
+
                 } else {
                     // If no hits, just background color contribution
                     final_color += reflection_factor * world.get_background_color();
@@ -137,6 +364,10 @@ class camera {
                 }
             }
 
+            if (stats) {
+                stats->paths.fetch_add(1, std::memory_order_relaxed);
+                stats->segments.fetch_add(rays_cast, std::memory_order_relaxed);
+            }
             return final_color;
         }
 };
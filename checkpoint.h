@@ -0,0 +1,252 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+#include "frame_cache.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "sha256.h"
+#include "thread_pool.h"
+#include "tile.h"
+
+struct checkpoint_options {
+    std::string path;                 // Checkpoint file; resumed from if it matches the render
+    double interval_seconds = 30;     // Time between checkpoints, 0 = only resume, never save
+    int tile_size = 32;               // Edge length of the square tiles
+    int samples_per_visit = 0;        // Samples a tile gets per visit, 0 = all at once
+    int threads = 0;                  // Worker threads, 0 = one per hardware thread
+};
+
+/**
+ * Tile render that survives being killed. Every interval_seconds the per-tile sample
+ * counts and the running color sums of started tiles are written to a compact binary
+ * checkpoint (through a temporary file, so a kill mid-write leaves the old one intact).
+ * On start a checkpoint for the same scene and camera is picked up and only the missing
+ * work is traced, so a restart loses at most one interval plus the tiles in progress.
+ * With samples_per_visit set, long multi-sample tiles are saved part way too.
+ *
+ * Samples are summed in the same order as camera::pixel_color, so a resumed render is
+ * bit-identical to an uninterrupted one. The checkpoint is deleted once the image is done.
+ *
+ * A world scene_io can't describe has no key to tell its checkpoints apart from another
+ * scene's, so such renders neither resume nor write checkpoints.
+ *
+ * File layout (native byte order):
+ *   char[8]   "RTCKPT2"
+ *   char[64]  SHA-256 of frame_key(world, cam, "checkpoint"), in hex
+ *   int32     width, height, tile_size, samples_per_pixel
+ *   uint32    samples done, per tile in make_tiles order
+ *   double    color sums, 3 per pixel, for each tile with samples done > 0
+ */
+class checkpointed_render {
+    public:
+        checkpointed_render(camera cam, const hittable_list& world, const checkpoint_options& options)
+            : cam(cam), world(world), options(options) {
+            this->cam.initialize();
+            width = this->cam.image_width;
+            height = this->cam.get_image_height();
+            samples_per_pixel = std::max(1, this->cam.samples_per_pixel);
+            tiles = make_tiles(width, height, options.tile_size);
+            samples_done.assign(tiles.size(), 0);
+            sums.assign(size_t(width) * height, color(0, 0, 0));
+            std::string key = frame_key(world, cam, "checkpoint");
+            if (!key.empty()) scene_digest = sha256_hex(key);
+        }
+
+        /** False if the world can't be identified, so nothing is resumed or saved. */
+        bool can_checkpoint() const { return !scene_digest.empty(); }
+
+        /** Loads a matching checkpoint if there is one. Returns the fraction of the work it restored. */
+        double resume() {
+            if (!can_checkpoint()) {
+                if (cam.verbose)
+                    std::cerr << "Warning: world has no scene_io form, not resuming from " << options.path << ".\n";
+                return 0;
+            }
+            std::ifstream in(options.path, std::ios::binary);
+            if (!in) return 0;
+
+            char magic[8];
+            char digest[64];
+            std::int32_t header[4];
+            in.read(magic, sizeof(magic));
+            in.read(digest, sizeof(digest));
+            in.read(reinterpret_cast<char*>(header), sizeof(header));
+            if (!in || std::memcmp(magic, file_magic, sizeof(magic)) != 0
+                || std::string(digest, sizeof(digest)) != scene_digest
+                || header[0] != width || header[1] != height || header[2] != options.tile_size
+                || header[3] != samples_per_pixel) {
+                if (cam.verbose) std::cerr << "Warning: " << options.path << " belongs to a different render, ignoring it.\n";
+                return 0;
+            }
+
+            std::vector<std::uint32_t> done(tiles.size());
+            in.read(reinterpret_cast<char*>(done.data()), std::streamsize(done.size() * sizeof(std::uint32_t)));
+            std::vector<color> loaded(sums.size(), color(0, 0, 0));
+            std::vector<double> tile_sums;
+            for (size_t k = 0; k < tiles.size() && in; k++) {
+                if (done[k] == 0) continue;
+                const tile& t = tiles[k];
+                tile_sums.resize(size_t(t.width()) * t.height() * 3);
+                in.read(reinterpret_cast<char*>(tile_sums.data()), std::streamsize(tile_sums.size() * sizeof(double)));
+                size_t p = 0;
+                for (int j = t.y0; j < t.y1; j++)
+                    for (int i = t.x0; i < t.x1; i++, p += 3)
+                        loaded[size_t(j) * width + i] = color(tile_sums[p], tile_sums[p + 1], tile_sums[p + 2]);
+            }
+            if (!in) {
+                if (cam.verbose) std::cerr << "Warning: " << options.path << " is truncated, ignoring it.\n";
+                return 0;
+            }
+
+            samples_done = std::move(done);
+            sums = std::move(loaded);
+            double restored = 0;
+            for (size_t k = 0; k < tiles.size(); k++)
+                restored += double(samples_done[k]) * tiles[k].width() * tiles[k].height();
+            return restored / (double(samples_per_pixel) * width * height);
+        }
+
+        /** Renders whatever is missing into image, checkpointing along the way. */
+        bool run(framebuffer& image) {
+            std::deque<size_t> queue;
+            for (size_t k = 0; k < tiles.size(); k++)
+                if (samples_done[k] < std::uint32_t(samples_per_pixel)) queue.push_back(k);
+
+            int samples_per_visit = options.samples_per_visit > 0 ? options.samples_per_visit : samples_per_pixel;
+            size_t unfinished = queue.size();
+            std::condition_variable finished;
+
+            auto worker = [&]() {
+                std::vector<color> local;
+                std::vector<const hittable*> candidates;
+                for (;;) {
+                    size_t k;
+                    std::uint32_t first_sample;
+                    {
+                        std::unique_lock<std::mutex> lock(mtx);
+                        finished.wait(lock, [&] { return !queue.empty() || unfinished == 0; });
+                        if (queue.empty()) return;
+                        k = queue.front();
+                        queue.pop_front();
+                        first_sample = samples_done[k];
+                        copy_tile(tiles[k], sums, local);
+                    }
+
+                    const tile& t = tiles[k];
+                    std::uint32_t last_sample = std::min<std::uint32_t>(samples_per_pixel, first_sample + samples_per_visit);
+                    const auto* primary = cam.primary_candidates(world, t, candidates) ? &candidates : nullptr;
+                    size_t p = 0;
+                    for (int j = t.y0; j < t.y1; j++)
+                        for (int i = t.x0; i < t.x1; i++, p++)
+                            for (std::uint32_t s = first_sample; s < last_sample; s++)
+                                local[p] += cam.sample_color(world, i, j, int(s), primary);
+
+                    std::lock_guard<std::mutex> lock(mtx);
+                    p = 0;
+                    for (int j = t.y0; j < t.y1; j++)
+                        for (int i = t.x0; i < t.x1; i++, p++)
+                            sums[size_t(j) * width + i] = local[p];
+                    samples_done[k] = last_sample;
+                    if (last_sample < std::uint32_t(samples_per_pixel)) queue.push_back(k);
+                    else unfinished--;
+                    finished.notify_all();
+                }
+            };
+
+            thread_pool pool(options.threads);
+            for (int n = 0; n < pool.size(); n++)
+                pool.submit(worker);
+
+            if (can_checkpoint() && options.interval_seconds > 0) {
+                auto interval = std::chrono::duration<double>(options.interval_seconds);
+                for (;;) {
+                    {
+                        std::unique_lock<std::mutex> lock(mtx);
+                        if (finished.wait_for(lock, interval, [&] { return unfinished == 0; })) break;
+                    }
+                    write_file_atomic(options.path, serialize());
+                }
+            } else if (!can_checkpoint() && cam.verbose) {
+                std::cerr << "Warning: world has no scene_io form, rendering without checkpoints.\n";
+            }
+
+            pool.wait_idle();
+
+            image = framebuffer(width, height);
+            for (int j = 0; j < height; j++)
+                for (int i = 0; i < width; i++)
+                    image.at(i, j) = sums[size_t(j) * width + i] / samples_per_pixel;
+
+            // A checkpoint we couldn't have matched may belong to another render
+            if (can_checkpoint()) {
+                std::error_code ec;
+                std::filesystem::remove(options.path, ec);
+            }
+            return true;
+        }
+
+    private:
+        static constexpr char file_magic[8] = "RTCKPT2";
+
+        camera cam;
+        const hittable_list& world;
+        checkpoint_options options;
+        int width, height, samples_per_pixel;
+        std::string scene_digest;                  // Empty if the world has no scene_io form
+        std::vector<tile> tiles;
+
+        std::mutex mtx;
+        std::vector<std::uint32_t> samples_done;   // Samples summed so far, per tile
+        std::vector<color> sums;                   // Running color sum, per pixel
+
+        void copy_tile(const tile& t, const std::vector<color>& from, std::vector<color>& to) const {
+            to.clear();
+            for (int j = t.y0; j < t.y1; j++)
+                for (int i = t.x0; i < t.x1; i++)
+                    to.push_back(from[size_t(j) * width + i]);
+        }
+
+        /**
+         * Checkpoint bytes. Takes mtx for one tile at a time, so a worker merging its result
+         * waits for at most one tile's copy. Each tile's count and sums are consistent;
+         * tiles may be caught at different moments, which resume() doesn't mind.
+         */
+        std::string serialize() {
+            std::vector<std::uint32_t> done(tiles.size());
+            std::vector<color> local;
+            std::string tile_sums;
+            for (size_t k = 0; k < tiles.size(); k++) {
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    done[k] = samples_done[k];
+                    if (done[k] > 0) copy_tile(tiles[k], sums, local);
+                }
+                if (done[k] > 0)
+                    tile_sums.append(reinterpret_cast<const char*>(local.data()), local.size() * sizeof(color));
+            }
+
+            std::string out(file_magic, sizeof(file_magic));
+            std::int32_t header[4] = {width, height, options.tile_size, samples_per_pixel};
+            out.append(scene_digest);
+            out.append(reinterpret_cast<const char*>(header), sizeof(header));
+            out.append(reinterpret_cast<const char*>(done.data()), done.size() * sizeof(std::uint32_t));
+            out.append(tile_sums);
+            return out;
+        }
+};
+
+#endif
@@ -19,4 +19,10 @@ void write_color(std::ostream& out, const color& pixel_color) {
     out << rbyte << ' ' << gbyte << ' ' << bbyte << '\n';
 }
 
+/** Same [0, 1] to [0, 255] mapping as write_color, clamped to fit a byte for binary output. */
+inline unsigned char color_to_byte(double c) {
+    int byte = int(255.999 * c);
+    return (unsigned char)(byte < 0 ? 0 : (byte > 255 ? 255 : byte));
+}
+
 #endif
\ No newline at end of file
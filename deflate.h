@@ -0,0 +1,190 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Self-contained deflate (RFC 1951) compressor and the checksums PNG needs, so the image
+ * encoders don't depend on zlib.
+ *
+ * The compressor does LZ77 over a 32 KB window with hash chains and writes fixed Huffman
+ * codes. That gives up a little ratio against dynamic codes but needs no per-block code
+ * tables. Every call compresses its input independently and ends byte-aligned, so
+ * separately compressed pieces can be concatenated into one valid deflate stream, which
+ * is what lets images be compressed stripe by stripe in parallel.
+ */
+
+inline std::uint32_t crc32_update(std::uint32_t crc, const unsigned char* data, size_t size) {
+    static const std::vector<std::uint32_t> table = [] {
+        std::vector<std::uint32_t> t(256);
+        for (std::uint32_t n = 0; n < 256; n++) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t k = 0; k < size; k++)
+        crc = table[(crc ^ data[k]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+const std::uint32_t adler_base = 65521;
+
+inline std::uint32_t adler32_update(std::uint32_t adler, const unsigned char* data, size_t size) {
+    std::uint32_t a = adler & 0xffff, b = adler >> 16;
+    while (size > 0) {
+        // 5552 is the most bytes that can be summed before b might overflow 32 bits
+        size_t block = size < 5552 ? size : 5552;
+        size -= block;
+        while (block--) {
+            a += *data++;
+            b += a;
+        }
+        a %= adler_base;
+        b %= adler_base;
+    }
+    return (b << 16) | a;
+}
+
+/** Adler-32 of A followed by B, from adler(A), adler(B) and B's length. Same math as zlib's. */
+inline std::uint32_t adler32_combine(std::uint32_t adler_a, std::uint32_t adler_b, std::uint64_t length_b) {
+    std::uint64_t remainder = length_b % adler_base;
+    std::uint64_t sum1 = adler_a & 0xffff;
+    std::uint64_t sum2 = (remainder * sum1) % adler_base;
+    sum1 += (adler_b & 0xffff) + adler_base - 1;
+    sum2 += (adler_a >> 16) + (adler_b >> 16) + adler_base - remainder;
+    if (sum1 >= adler_base) sum1 -= adler_base;
+    if (sum1 >= adler_base) sum1 -= adler_base;
+    if (sum2 >= 2ull * adler_base) sum2 -= 2ull * adler_base;
+    if (sum2 >= adler_base) sum2 -= adler_base;
+    return std::uint32_t(sum1 | (sum2 << 16));
+}
+
+/**
+ * Compresses data as one fixed-Huffman block. If final is false the block is followed by
+ * an empty stored block (a "sync flush"), which byte-aligns the output so the next piece
+ * can simply be appended; if final is true the block closes the stream.
+ */
+inline std::string deflate_compress(const unsigned char* data, size_t size, bool final) {
+    static const int length_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                         3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const int distance_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                          257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                          8193, 12289, 16385, 24577};
+    static const int distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                           7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    std::string out;
+    out.reserve(size / 4 + 16);
+    std::uint32_t bit_buffer = 0;
+    int bit_count = 0;
+
+    /** Deflate packs values LSB first */
+    auto put_bits = [&](std::uint32_t value, int count) {
+        bit_buffer |= value << bit_count;
+        bit_count += count;
+        while (bit_count >= 8) {
+            out += char(bit_buffer & 0xff);
+            bit_buffer >>= 8;
+            bit_count -= 8;
+        }
+    };
+    /** ...but Huffman codes MSB first */
+    auto put_code = [&](std::uint32_t code, int length) {
+        std::uint32_t reversed = 0;
+        for (int k = 0; k < length; k++)
+            reversed |= ((code >> k) & 1) << (length - 1 - k);
+        put_bits(reversed, length);
+    };
+    auto put_literal_length = [&](int symbol) {
+        if (symbol < 144) put_code(0x30 + symbol, 8);
+        else if (symbol < 256) put_code(0x190 + symbol - 144, 9);
+        else if (symbol < 280) put_code(symbol - 256, 7);
+        else put_code(0xc0 + symbol - 280, 8);
+    };
+    auto put_match = [&](int length, int distance) {
+        int l = 28;
+        while (length_base[l] > length) l--;
+        put_literal_length(257 + l);
+        put_bits(std::uint32_t(length - length_base[l]), length_extra[l]);
+
+        int d = 29;
+        while (distance_base[d] > distance) d--;
+        put_code(std::uint32_t(d), 5);
+        put_bits(std::uint32_t(distance - distance_base[d]), distance_extra[d]);
+    };
+
+    put_bits(final ? 1 : 0, 1);
+    put_bits(1, 2);                 // Fixed Huffman codes
+
+    const int window = 32768, min_match = 3, max_match = 258, max_chain = 32;
+    const int hash_bits = 15;
+    std::vector<std::int32_t> head(1 << hash_bits, -1);
+    std::vector<std::int32_t> previous(window, -1);
+    auto hash_at = [&](size_t p) {
+        std::uint32_t v = std::uint32_t(data[p]) | (std::uint32_t(data[p + 1]) << 8) | (std::uint32_t(data[p + 2]) << 16);
+        return (v * 2654435761u) >> (32 - hash_bits);
+    };
+    auto insert = [&](size_t p) {
+        std::uint32_t h = hash_at(p);
+        previous[p % window] = head[h];
+        head[h] = std::int32_t(p);
+    };
+
+    size_t p = 0;
+    while (p < size) {
+        int best_length = 0, best_distance = 0;
+        if (p + min_match <= size) {
+            int limit = int(std::min<size_t>(max_match, size - p));
+            std::int32_t candidate = head[hash_at(p)];
+            for (int chain = 0; candidate >= 0 && chain < max_chain; chain++) {
+                size_t distance = p - size_t(candidate);
+                if (distance > size_t(window)) break;
+                const unsigned char* a = data + candidate;
+                const unsigned char* b = data + p;
+                int length = 0;
+                while (length < limit && a[length] == b[length]) length++;
+                if (length > best_length) {
+                    best_length = length;
+                    best_distance = int(distance);
+                    if (length == limit) break;
+                }
+                std::int32_t next = previous[size_t(candidate) % window];
+                if (next >= candidate) break;   // Slot was reused by a newer position
+                candidate = next;
+            }
+        }
+
+        if (best_length >= min_match) {
+            put_match(best_length, best_distance);
+            for (int k = 0; k < best_length; k++, p++)
+                if (p + min_match <= size) insert(p);
+        } else {
+            put_literal_length(data[p]);
+            if (p + min_match <= size) insert(p);
+            p++;
+        }
+    }
+    put_literal_length(256);         // End of block
+
+    if (!final) {
+        put_bits(0, 1);
+        put_bits(0, 2);              // Stored block...
+        if (bit_count > 0) put_bits(0, 8 - bit_count);
+        out += std::string("\x00\x00\xff\xff", 4);  // ...of length 0
+    } else if (bit_count > 0) {
+        put_bits(0, 8 - bit_count);
+    }
+    return out;
+}
+
+#endif
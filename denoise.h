@@ -0,0 +1,171 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "thread_pool.h"
+#include "tile.h"
+
+/**
+ * Edge-avoiding à-trous wavelet filter (Dammertz et al. 2010) for low-sample renders.
+ *
+ * Each pass blurs with a 5x5 B3-spline kernel whose taps are spread 1, 2, 4, ... pixels
+ * apart, so a few passes cover a wide footprint at 25 taps per pixel each. Every tap is
+ * weighted down by how much the guide buffers differ from the center pixel (albedo,
+ * normal and depth) and by how much its color differs, measured against the center
+ * pixel's own noise as in SVGF (Schied et al. 2017).
+ *
+ * The noise is the variance of the pixel's samples, which camera::pixel_color records
+ * along with the guides. Shading in this renderer is deterministic unless paths end by
+ * russian_roulette, so only pixels where the roulette actually cut paths at random are
+ * filtered; everything else is left exactly as rendered. Elsewhere the only error is
+ * edges, on silhouettes, shadows or in reflections, and how much of a pixel each side of
+ * an edge covers is something its neighbors can't tell. For the same reason a pixel whose
+ * samples hit different surfaces first is never filtered. Each pass also filters the
+ * variance, so later passes smooth less. Below 8 samples per pixel the variance of each
+ * pixel is too rough an estimate, and the spread of its 3x3 neighbors of the same
+ * material is used instead.
+ *
+ * Works on the linear colors, before quantization. Each pass runs tile by tile on a
+ * thread pool, reading the previous pass's image and writing a fresh one.
+ */
+
+struct denoise_options {
+    int passes = 3;               // Kernel spreads of 1, 2, 4, ... pixels
+    double sigma_color = 4.0;     // Tolerated color difference, in standard deviations of the pixel's noise
+    double sigma_normal = 0.3;    // Tolerated normal difference
+    double sigma_depth = 0.05;    // Tolerated depth difference, relative to the depth per tap step
+    double sigma_albedo = 0.05;   // Tolerated albedo difference
+    int tile_size = 64;           // Edge length of the square tiles worked on in parallel
+    int threads = 0;              // Worker threads, 0 = one per hardware thread
+};
+
+/** Filters image in place, guided by aux. Returns false if their sizes differ. */
+inline bool denoise(framebuffer& image, const aux_buffers& aux, const denoise_options& options = denoise_options()) {
+    int width = image.get_width(), height = image.get_height();
+    if (aux.get_width() != width || aux.get_height() != height) {
+        std::cerr << "Error: denoise guide buffers are " << aux.get_width() << 'x' << aux.get_height()
+                  << ", image is " << width << 'x' << height << ".\n";
+        return false;
+    }
+
+    // Fewer samples than this give too rough a variance; neighbors estimate it instead
+    const int spatial_variance_below = 8;
+    static const double kernel[3] = {3.0 / 8.0, 1.0 / 4.0, 1.0 / 16.0};
+    std::vector<tile> tiles = make_tiles(width, height, options.tile_size);
+    thread_pool pool(options.threads);
+    framebuffer source = image;
+    std::vector<double> variance = aux.variance, next_variance(variance.size());
+
+    if (aux.samples < spatial_variance_below) {
+        for (const tile& t : tiles) {
+            pool.submit([&, t] {
+                for (int j = t.y0; j < t.y1; j++) {
+                    for (int i = t.x0; i < t.x1; i++) {
+                        size_t p = aux.index(i, j);
+                        color sum(0, 0, 0), sum_squares(0, 0, 0);
+                        int count = 0;
+                        for (int y = std::max(0, j - 1); y <= std::min(height - 1, j + 1); y++) {
+                            for (int x = std::max(0, i - 1); x <= std::min(width - 1, i + 1); x++) {
+                                if (aux.material_id[aux.index(x, y)] != aux.material_id[p]) continue;
+                                sum += source.at(x, y);
+                                sum_squares += source.at(x, y) * source.at(x, y);
+                                count++;
+                            }
+                        }
+                        color spread = sum_squares / count - (sum / count) * (sum / count);
+                        variance[p] = count > 1 ? std::max(0.0, spread.x() + spread.y() + spread.z()) : 0;
+                    }
+                }
+            });
+        }
+        pool.wait_idle();
+    }
+
+    const double normal_scale = 1.0 / (options.sigma_normal * options.sigma_normal);
+    const double albedo_scale = 1.0 / (options.sigma_albedo * options.sigma_albedo);
+
+    for (int pass = 0; pass < options.passes; pass++) {
+        int step = 1 << pass;
+
+        for (const tile& t : tiles) {
+            pool.submit([&, t, step] {
+                for (int j = t.y0; j < t.y1; j++) {
+                    for (int i = t.x0; i < t.x1; i++) {
+                        size_t p = aux.index(i, j);
+                        const color& center = source.at(i, j);
+                        if (!aux.random[p] || aux.coverage[p] < 1 || variance[p] <= 0) {
+                            image.at(i, j) = center;
+                            next_variance[p] = 0;
+                            continue;
+                        }
+                        double color_scale = 1.0 / (options.sigma_color * std::sqrt(variance[p]));
+
+                        color sum(0, 0, 0);
+                        double weight_sum = 0, variance_sum = 0;
+
+                        for (int dy = -2; dy <= 2; dy++) {
+                            int y = j + dy * step;
+                            if (y < 0 || y >= height) continue;
+                            for (int dx = -2; dx <= 2; dx++) {
+                                int x = i + dx * step;
+                                if (x < 0 || x >= width) continue;
+                                size_t q = aux.index(x, y);
+
+                                double exponent = (source.at(x, y) - center).length() * color_scale
+                                                + (aux.albedo[q] - aux.albedo[p]).length_squared() * albedo_scale;
+                                // Surface guides only compare between surfaces, the background has none
+                                if (aux.material_id[p] && aux.material_id[q]) {
+                                    exponent += (aux.normal[q] - aux.normal[p]).length_squared() * normal_scale;
+                                    exponent += std::fabs(aux.depth[q] - aux.depth[p])
+                                              / (options.sigma_depth * aux.depth[p] * step);
+                                }
+
+                                double weight = kernel[std::abs(dx)] * kernel[std::abs(dy)] * std::exp(-exponent);
+                                sum += weight * source.at(x, y);
+                                weight_sum += weight;
+                                variance_sum += weight * weight * variance[q];
+                            }
+                        }
+
+                        // The center tap always counts, so weight_sum > 0
+                        image.at(i, j) = sum / weight_sum;
+                        next_variance[p] = variance_sum / (weight_sum * weight_sum);
+                    }
+                }
+            });
+        }
+        pool.wait_idle();
+        if (pass + 1 < options.passes) {
+            source = image;
+            variance.swap(next_variance);
+        }
+    }
+    return true;
+}
+
+/**
+ * Renders world through cam into image and its guide buffers into aux, tile by tile on
+ * threads. The guides come from the color samples' own first hits, so they cost next to
+ * nothing on top of the render.
+ */
+inline void render_with_aux(camera cam, const hittable_list& world, framebuffer& image, aux_buffers& aux,
+                            int threads = 0, int tile_size = 32) {
+    cam.verbose = false;
+    cam.initialize();
+    image = framebuffer(cam.image_width, cam.get_image_height());
+    aux = aux_buffers(cam.image_width, cam.get_image_height());
+    aux.samples = cam.samples_per_pixel;
+
+    thread_pool pool(threads);
+    for (const tile& t : make_tiles(image.get_width(), image.get_height(), tile_size))
+        pool.submit([&, t] { cam.render_tile(world, image, t, &aux); });
+    pool.wait_idle();
+}
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "scene_io.h"
+#include "socket_io.h"
+#include "tile.h"
+
+/**
+ * Tile rendering spread over worker processes (POSIX only).
+ *
+ * Coordinator to worker, one command per line:
+ *   scene                     followed by a scene in the scene_io text form, ending in "end"
+ *   tile <id> x0 y0 x1 y1     render a tile of the last scene
+ *   quit
+ *
+ * Worker to coordinator:
+ *   ready                     the scene was read
+ *   error <message>           the scene couldn't be read; the worker hangs up next
+ *   tile <id>                 followed by the tile's colors as raw doubles, 3 per pixel,
+ *                             row by row
+ *
+ * Colors travel as the doubles the worker computed, so the assembled frame is identical to
+ * a single-process render. Raw doubles assume coordinator and workers share a byte order.
+ */
+
+/** Serves one coordinator over fd until it sends quit or hangs up. */
+inline void run_render_worker(int fd) {
+    hittable_list world;
+    camera cam;
+    bool have_scene = false;
+    std::string line;
+    std::vector<double> pixels;
+    std::vector<const hittable*> candidates;
+
+    while (socket_io::recv_line(fd, line)) {
+        if (line == "quit") return;
+
+        if (line == "scene") {
+            std::string scene_text;
+            while (socket_io::recv_line(fd, line)) {
+                scene_text += line + '\n';
+                if (line == "end") break;
+            }
+
+            // The coordinator renders whatever size it was asked to, so size caps don't apply
+            world = hittable_list();
+            cam = camera();
+            std::string error;
+            std::istringstream scene(scene_text);
+            if (!read_scene(scene, world, cam, error, scene_limits::none())) {
+                std::string reply = "error " + error + '\n';
+                socket_io::send_all(fd, reply.data(), reply.size());
+                return;
+            }
+            cam.verbose = false;
+            cam.initialize();
+            have_scene = true;
+            if (!socket_io::send_all(fd, "ready\n", 6)) return;
+            continue;
+        }
+
+        std::istringstream command(line);
+        std::string kind;
+        int id;
+        tile t;
+        if (!(command >> kind >> id >> t.x0 >> t.y0 >> t.x1 >> t.y1) || kind != "tile" || !have_scene) return;
+
+        pixels.clear();
+        const auto* primary = cam.primary_candidates(world, t, candidates) ? &candidates : nullptr;
+        for (int j = t.y0; j < t.y1; j++) {
+            for (int i = t.x0; i < t.x1; i++) {
+                color c = cam.pixel_color(world, i, j, primary);
+                pixels.insert(pixels.end(), {c.x(), c.y(), c.z()});
+            }
+        }
+
+        std::string header = "tile " + std::to_string(id) + '\n';
+        if (!socket_io::send_all(fd, header.data(), header.size())
+            || !socket_io::send_all(fd, pixels.data(), pixels.size() * sizeof(double)))
+            return;
+    }
+}
+
+/**
+ * Accepts coordinators on a TCP port, serving one at a time, so hosts other than the
+ * coordinator's can contribute. Only returns if the port can't be opened or the listening
+ * socket stops working.
+ */
+inline bool serve_render_worker(int port) {
+    int listen_fd = socket_io::listen_tcp(port);
+    if (listen_fd < 0) return false;
+
+    for (;;) {
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            // A connection that died before it was accepted: take the next one
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) continue;
+            // Out of descriptors or memory: give the ones in use a moment to be released
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                timespec pause{0, 100 * 1000 * 1000};
+                ::nanosleep(&pause, nullptr);
+                continue;
+            }
+            ::close(listen_fd);
+            return false;
+        }
+        socket_io::set_no_delay(fd);
+        run_render_worker(fd);
+        ::close(fd);
+    }
+}
+
+/**
+ * Hands the tiles of a frame out to worker processes and assembles the result. Each
+ * worker keeps a few tiles queued to hide round trips. When a worker dies, or takes longer
+ * than tile_timeout on a tile, its unfinished tiles go back to the queue for the others;
+ * if none are left, the coordinator renders the rest itself.
+ */
+class render_coordinator {
+    public:
+        int tile_size = 32;          // Edge length of the square tiles handed out
+        int tiles_in_flight = 2;     // Tiles queued on each worker at once
+        double tile_timeout = 120;   // Seconds a worker may spend on one tile, 0 = wait forever
+
+        render_coordinator() {}
+        render_coordinator(const render_coordinator&) = delete;
+        render_coordinator& operator=(const render_coordinator&) = delete;
+
+        ~render_coordinator() {
+            for (auto& w : workers) {
+                if (w.fd >= 0) {
+                    socket_io::send_all(w.fd, "quit\n", 5);
+                    ::close(w.fd);
+                }
+                if (w.pid > 0) ::waitpid(w.pid, nullptr, 0);
+            }
+        }
+
+        /**
+         * Forks count workers on this host, connected through socket pairs. Fork before
+         * this process starts any threads of its own.
+         */
+        bool spawn_local_workers(int count) {
+            for (int n = 0; n < count; n++) {
+                int ends[2];
+                if (::socketpair(AF_UNIX, SOCK_STREAM, 0, ends) < 0) return false;
+
+                pid_t pid = ::fork();
+                if (pid < 0) {
+                    ::close(ends[0]);
+                    ::close(ends[1]);
+                    return false;
+                }
+                if (pid == 0) {
+                    ::close(ends[0]);
+                    for (auto& w : workers)
+                        if (w.fd >= 0) ::close(w.fd);
+                    run_render_worker(ends[1]);
+                    ::_exit(0);
+                }
+
+                ::close(ends[1]);
+                workers.push_back({ends[0], pid, {}});
+            }
+            return true;
+        }
+
+        /** Adds a worker started elsewhere with serve_render_worker. */
+        bool connect_worker(const std::string& host, int port) {
+            int fd = socket_io::connect_tcp(host, port);
+            if (fd < 0) return false;
+            workers.push_back({fd, -1, {}});
+            return true;
+        }
+
+        int worker_count() const {
+            int alive = 0;
+            for (const auto& w : workers)
+                if (w.fd >= 0) alive++;
+            return alive;
+        }
+
+        /**
+         * Renders world through cam into image. Fails if the scene can't be sent or a worker
+         * rejects it, e.g. for a camera that can't be rendered, rather than rendering alone.
+         */
+        bool render(const hittable_list& world, camera cam, framebuffer& image, std::string& error) {
+            std::ostringstream scene;
+            scene << "scene\n";
+            if (!write_scene(scene, world, cam)) {
+                error = "world holds objects with no scene_io form";
+                return false;
+            }
+            std::string scene_text = scene.str();
+
+            cam.verbose = false;
+            cam.initialize();
+            image = framebuffer(cam.image_width, cam.get_image_height());
+            std::vector<tile> tiles = make_tiles(image.get_width(), image.get_height(), tile_size);
+
+            std::deque<int> pending;
+            for (int id = 0; id < int(tiles.size()); id++)
+                pending.push_back(id);
+            size_t finished = 0;
+
+            // Also bounds each receive, so a worker that stops halfway through a tile can't stall us
+            for (auto& w : workers) {
+                if (w.fd < 0) continue;
+                socket_io::set_receive_timeout(w.fd, tile_timeout);
+                if (!socket_io::send_all(w.fd, scene_text.data(), scene_text.size()))
+                    retire(w, pending);
+            }
+            for (auto& w : workers) {
+                std::string line;
+                if (w.fd < 0 || (socket_io::recv_line(w.fd, line) && line == "ready")) continue;
+                retire(w, pending);
+                if (line.compare(0, 6, "error ") == 0) {
+                    error = "worker rejected the scene: " + line.substr(6);
+                    return false;
+                }
+            }
+
+            auto tile_time = std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(tile_timeout));
+            std::vector<double> pixels;
+            while (finished < tiles.size()) {
+                for (auto& w : workers) {
+                    while (w.fd >= 0 && int(w.in_flight.size()) < tiles_in_flight && !pending.empty()) {
+                        int id = pending.front();
+                        const tile& t = tiles[id];
+                        std::string command = "tile " + std::to_string(id) + ' ' + std::to_string(t.x0) + ' '
+                                            + std::to_string(t.y0) + ' ' + std::to_string(t.x1) + ' '
+                                            + std::to_string(t.y1) + '\n';
+                        if (!socket_io::send_all(w.fd, command.data(), command.size())) {
+                            retire(w, pending);
+                            break;
+                        }
+                        pending.pop_front();
+                        if (w.in_flight.empty()) w.deadline = clock::now() + tile_time;
+                        w.in_flight.push_back(id);
+                    }
+                }
+
+                if (worker_count() == 0) {
+                    for (int id : pending)
+                        cam.render_tile(world, image, tiles[id]);
+                    return true;
+                }
+
+                std::vector<pollfd> watch;
+                std::vector<worker*> watched;
+                clock::time_point first_deadline = clock::time_point::max();
+                for (auto& w : workers) {
+                    if (w.fd >= 0 && !w.in_flight.empty()) {
+                        watch.push_back({w.fd, POLLIN, 0});
+                        watched.push_back(&w);
+                        first_deadline = std::min(first_deadline, w.deadline);
+                    }
+                }
+                int wait_ms = -1;
+                if (tile_timeout > 0) {
+                    auto left = std::chrono::ceil<std::chrono::milliseconds>(first_deadline - clock::now());
+                    wait_ms = int(std::clamp<std::chrono::milliseconds::rep>(left.count(), 0, 60 * 60 * 1000));
+                }
+                if (::poll(watch.data(), watch.size(), wait_ms) < 0) continue;
+
+                for (size_t k = 0; k < watch.size(); k++) {
+                    worker& w = *watched[k];
+                    if (!(watch[k].revents & (POLLIN | POLLHUP | POLLERR))) {
+                        if (tile_timeout > 0 && clock::now() >= w.deadline) retire(w, pending);
+                        continue;
+                    }
+
+                    std::string line;
+                    int id = w.in_flight.front();
+                    const tile& t = tiles[id];
+                    pixels.resize(size_t(t.width()) * t.height() * 3);
+                    if (!socket_io::recv_line(w.fd, line) || line != "tile " + std::to_string(id)
+                        || !socket_io::recv_all(w.fd, pixels.data(), pixels.size() * sizeof(double))) {
+                        retire(w, pending);
+                        continue;
+                    }
+
+                    size_t p = 0;
+                    for (int j = t.y0; j < t.y1; j++) {
+                        for (int i = t.x0; i < t.x1; i++, p += 3)
+                            image.at(i, j) = color(pixels[p], pixels[p + 1], pixels[p + 2]);
+                    }
+                    w.in_flight.pop_front();
+                    w.deadline = clock::now() + tile_time;
+                    finished++;
+                }
+            }
+            return true;
+        }
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        struct worker {
+            int fd;                    // -1 once the worker is gone
+            pid_t pid;                 // Child process, or -1 for remote workers
+            std::deque<int> in_flight; // Tiles sent and not yet returned, oldest first
+            clock::time_point deadline = {};  // When the oldest tile in flight is given up on
+        };
+
+        std::vector<worker> workers;
+
+        /** Drops a dead or misbehaving worker and requeues its tiles first in line. */
+        void retire(worker& w, std::deque<int>& pending) {
+            ::close(w.fd);
+            w.fd = -1;
+            pending.insert(pending.begin(), w.in_flight.begin(), w.in_flight.end());
+            w.in_flight.clear();
+        }
+};
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "scene_io.h"
+#include "sha256.h"
+
+/**
+ * Bump whenever a change to the renderer alters the pixels it produces for the same
+ * input, so frames cached by older builds are never returned.
+ */
+const int renderer_version = 1;
+
+/**
+ * Canonical description of everything that determines a frame's bytes: renderer version,
+ * output format, lighting, every object and material field, and the camera. Two renders
+ * with equal keys produce identical files. Empty if the world holds objects scene_io can't
+ * describe, in which case the frame must not be cached.
+ */
+inline std::string frame_key(const hittable_list& world, const camera& cam, const std::string& format) {
+    std::ostringstream key;
+    key << "renderer " << renderer_version << '\n';
+    key << "format " << format << '\n';
+    if (!write_scene(key, world, cam)) return "";
+    return key.str();
+}
+
+/**
+ * On-disk cache of encoded frames, addressed by frame_key. Each entry is one file,
+ * <sha256 of key>.frame, so the key itself is never stored and only frames count against
+ * max_bytes. Hits refresh the entry's timestamp; stores evict the least recently used
+ * entries until the cache fits in max_bytes.
+ *
+ * The directory is scanned once, at construction, into an in-memory index of entry sizes
+ * in least recently used order; lookups and stores never list it again. Entries written by
+ * other processes in the meantime are only seen after a restart.
+ *
+ * Safe to share between threads. Entries are written through temporary files and
+ * renamed into place, so concurrent processes never read a partial entry.
+ */
+class frame_cache {
+    public:
+        frame_cache(const std::string& directory, std::uintmax_t max_bytes)
+            : directory(directory), max_bytes(max_bytes) {
+            std::error_code ec;
+            std::filesystem::create_directories(directory, ec);
+            load_index();
+        }
+
+        bool lookup(const std::string& key, std::string& frame) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::string name = entry_name(key);
+            auto found = index.find(name);
+            if (found == index.end()) return false;
+
+            auto path = directory / name;
+            if (!read_file(path.string(), frame)) {
+                // Removed behind our back
+                forget(found);
+                return false;
+            }
+            recency.splice(recency.end(), recency, found->second.position);
+
+            std::error_code ec;
+            std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+            return true;
+        }
+
+        void store(const std::string& key, const std::string& frame) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::string name = entry_name(key);
+            if (!write_file_atomic((directory / name).string(), frame)) return;
+
+            auto found = index.find(name);
+            if (found != index.end()) forget(found);
+            add(name, frame.size());
+            evict();
+        }
+
+    private:
+        struct entry {
+            std::uintmax_t bytes;
+            std::list<std::string>::iterator position;  // In recency
+        };
+
+        std::filesystem::path directory;
+        std::uintmax_t max_bytes;
+        std::mutex mtx;
+        std::unordered_map<std::string, entry> index;  // By file name
+        std::list<std::string> recency;                // File names, least recently used first
+        std::uintmax_t total_bytes = 0;
+
+        static std::string entry_name(const std::string& key) { return sha256_hex(key) + ".frame"; }
+
+        void add(const std::string& name, std::uintmax_t bytes) {
+            recency.push_back(name);
+            index[name] = {bytes, std::prev(recency.end())};
+            total_bytes += bytes;
+        }
+
+        void forget(std::unordered_map<std::string, entry>::iterator found) {
+            total_bytes -= found->second.bytes;
+            recency.erase(found->second.position);
+            index.erase(found);
+        }
+
+        /** Indexes the frames already on disk, oldest first by timestamp. */
+        void load_index() {
+            struct on_disk {
+                std::string name;
+                std::filesystem::file_time_type used;
+                std::uintmax_t bytes;
+            };
+            std::vector<on_disk> found;
+
+            std::error_code ec;
+            for (const auto& file : std::filesystem::directory_iterator(directory, ec)) {
+                if (file.path().extension() != ".frame") continue;
+                std::uintmax_t bytes = file.file_size(ec);
+                if (ec) continue;
+                found.push_back({file.path().filename().string(), file.last_write_time(ec), bytes});
+            }
+
+            std::sort(found.begin(), found.end(),
+                      [](const on_disk& a, const on_disk& b) { return a.used < b.used; });
+            for (const auto& f : found)
+                add(f.name, f.bytes);
+            evict();
+        }
+
+        static bool read_file(const std::string& filename, std::string& contents) {
+            std::ifstream in(filename, std::ios::binary);
+            if (!in) return false;
+            std::ostringstream buffer;
+            buffer << in.rdbuf();
+            contents = buffer.str();
+            return true;
+        }
+
+        /** Drops the least recently used entries until the cache fits. */
+        void evict() {
+            while (total_bytes > max_bytes && !recency.empty()) {
+                std::error_code ec;
+                std::filesystem::remove(directory / recency.front(), ec);
+                forget(index.find(recency.front()));
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rtmath.h"
+
+/** Writes contents to filename through a temporary file, so readers never see a partial file. */
+inline bool write_file_atomic(const std::string& filename, const std::string& contents) {
+    std::string temp_name = filename + ".tmp";
+    {
+        std::ofstream output_file(temp_name, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!output_file) {
+            std::cerr << "Error: could not open file " << temp_name << " to write.\n";
+            return false;
+        }
+        output_file.write(contents.data(), std::streamsize(contents.size()));
+        if (!output_file) {
+            std::cerr << "Error: could not write " << temp_name << ".\n";
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_name, filename, ec);
+    if (ec) {
+        std::cerr << "Error: could not replace " << filename << ": " << ec.message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+/** 8-bit RGB image, three bytes per pixel in the same pixel order as framebuffer. */
+struct rgb8_image {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+/**
+ * In-memory image of linear pixel colors, row-major with pixel [0, 0] in the upper left,
+ * i.e. the same order camera::render writes them.
+ */
+class framebuffer {
+    public:
+        framebuffer() : width(0), height(0) {}
+        framebuffer(int width, int height)
+            : width(width), height(height), pixels(size_t(width) * height) {}
+
+        int get_width() const { return width; }
+        int get_height() const { return height; }
+
+        color& at(int i, int j) { return pixels[size_t(j) * width + i]; }
+        const color& at(int i, int j) const { return pixels[size_t(j) * width + i]; }
+
+        rgb8_image quantize() const {
+            rgb8_image image;
+            image.width = width;
+            image.height = height;
+            image.pixels.reserve(pixels.size() * 3);
+            for (const auto& pixel : pixels) {
+                image.pixels.push_back(color_to_byte(pixel.x()));
+                image.pixels.push_back(color_to_byte(pixel.y()));
+                image.pixels.push_back(color_to_byte(pixel.z()));
+            }
+            return image;
+        }
+
+        void write_ppm(std::ostream& out) const {
+            out << "P3\n" << width << ' ' << height << "\n255\n";
+            for (const auto& pixel : pixels)
+                write_color(out, pixel);
+        }
+
+        /** Writes to a temporary file first, so readers never see a half-written image. */
+        bool write_ppm(const std::string& filename) const {
+            return write_file_atomic(filename, encode_ppm());
+        }
+
+        std::string encode_ppm() const {
+            std::ostringstream out;
+            write_ppm(out);
+            return out.str();
+        }
+
+    private:
+        int width, height;
+        std::vector<color> pixels;
+};
+
+/**
+ * What the camera rays of each pixel hit first, same layout as framebuffer, recorded from
+ * the color samples themselves. Guides the denoiser: its edges are where these change, and
+ * it only smooths where random path termination made the samples disagree. Rays that
+ * escape count as the background, with no material and no normal; a pixel none of whose
+ * rays hit anything has depth infinity.
+ */
+class aux_buffers {
+    public:
+        std::vector<vec3> normal;                  // Mean surface normal, facing the camera
+        std::vector<double> depth;                 // Mean distance from the camera of the hits
+        std::vector<const material*> material_id;  // Material the center ray hit, nullptr for a miss
+        std::vector<color> albedo;                 // Mean diffuse color of what the rays hit
+        std::vector<double> coverage;              // Share of the rays that hit the center ray's surface
+        std::vector<double> variance;              // Variance of the pixel's mean color, 0 with one sample
+        std::vector<char> random;                  // russian_roulette cut some of the pixel's paths at random
+        int samples = 1;                           // Rays traced per pixel
+
+        aux_buffers() : width(0), height(0) {}
+        aux_buffers(int width, int height)
+            : normal(size_t(width) * height), depth(size_t(width) * height),
+              material_id(size_t(width) * height), albedo(size_t(width) * height),
+              coverage(size_t(width) * height), variance(size_t(width) * height),
+              random(size_t(width) * height),
+              width(width), height(height) {}
+
+        int get_width() const { return width; }
+        int get_height() const { return height; }
+        size_t index(int i, int j) const { return size_t(j) * width + i; }
+
+    private:
+        int width, height;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "rtmath.h"
+#include "aabb.h"
+
+/**
+ * The pyramid of rays leaving apex through a quadrilateral, as four planes through the
+ * apex with normals pointing inward. Used to find what a group of camera rays can reach.
+ */
+class frustum {
+    public:
+        frustum() {}
+
+        /** Corners in order around the quadrilateral, either winding. */
+        frustum(const point3& apex, const point3 corners[4]) : apex(apex) {
+            vec3 center = (corners[0] + corners[1] + corners[2] + corners[3]) / 4 - apex;
+            for (int k = 0; k < 4; k++) {
+                normal[k] = cross(corners[k] - apex, corners[(k + 1) % 4] - apex);
+                if (dot(normal[k], center) < 0) normal[k] = -normal[k];
+            }
+        }
+
+        /**
+         * False only if no ray of the frustum can reach the box. Conservative: boxes just
+         * outside a corner may still pass. Unbounded boxes always pass.
+         */
+        bool may_contain(const aabb& box) const {
+            if (!box.is_finite()) return true;
+            for (int k = 0; k < 4; k++) {
+                // The box corner furthest along the inward normal
+                point3 corner(normal[k][0] > 0 ? box.x.max : box.x.min,
+                              normal[k][1] > 0 ? box.y.max : box.y.min,
+                              normal[k][2] > 0 ? box.z.max : box.z.min);
+                if (dot(normal[k], corner - apex) < 0) return false;
+            }
+            return true;
+        }
+
+    private:
+        point3 apex;
+        vec3 normal[4];
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define HITTABLE_H
 
 #include "rtmath.h"
+#include "aabb.h"
 
 class hit_record {
     public: 
@@ -25,6 +26,15 @@ class hittable {
         virtual ~hittable() = default;
 
         virtual bool hit(const ray& r, interval ray_t, hit_record& rec) const = 0;
+
+        /** True if r hits anything in ray_t. Override when that is cheaper than finding the nearest hit. */
+        virtual bool occluded(const ray& r, interval ray_t) const {
+            hit_record rec;
+            return hit(r, ray_t, rec);
+        }
+
+        /** Box enclosing the object. Unbounded unless overridden, which accelerators handle separately. */
+        virtual aabb bounding_box() const { return aabb::universe; }
 };
 
 #endif
\ No newline at end of file
@@ -6,6 +6,26 @@
 #include "hittable.h"
 #include <vector>
 
+/**
+ * Closest hit of r in ray_t among objects, any sequence of pointers to hittables. On equal
+ * distances the earlier object wins.
+ */
+template <typename Objects>
+bool hit_closest(const Objects& objects, const ray& r, interval ray_t, hit_record& rec) {
+    hit_record temp_rec;
+    bool hit_anything = false;
+    auto closest_so_far = ray_t.max;
+
+    for (const auto& object : objects) {
+        if (object->hit(r, interval(ray_t.min, closest_so_far), temp_rec)) {
+            hit_anything = true;
+            closest_so_far = temp_rec.t;
+            rec = temp_rec;
+        }
+    }
+    return hit_anything;
+}
+
 class hittable_list : public hittable {
     public: 
         std::vector<shared_ptr<hittable>> objects;
@@ -15,34 +35,47 @@ class hittable_list : public hittable {
 
         void clear() { objects.clear(); }
 
+        /**
+         * Routes hit and occlusion queries through accelerator, which must hold exactly
+         * the objects in this list (e.g. a uniform_grid built from them). Pass nullptr to
+         * go back to testing every object. Rebuild it after adding or moving objects.
+         */
+        void set_accelerator(shared_ptr<hittable> accelerator) { this->accelerator = accelerator; }
+        const shared_ptr<hittable>& get_accelerator() const { return accelerator; }
+
         void add(shared_ptr<hittable> object) {
             objects.push_back(object);
         }
 
         bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
-            hit_record temp_rec;
-            bool hit_anything = false;
-            auto closest_so_far = ray_t.max;
-
-            for (const auto& object : objects) {
-                if (object->hit(r, interval(ray_t.min, closest_so_far), temp_rec)) {
-                    hit_anything = true;
-                    closest_so_far = temp_rec.t;
-                    rec = temp_rec;
-                }
-            }
-            return hit_anything;
+            if (accelerator) return accelerator->hit(r, ray_t, rec);
+            return hit_closest(objects, r, ray_t, rec);
+        }
+
+        bool occluded(const ray& r, interval ray_t) const override {
+            if (accelerator) return accelerator->occluded(r, ray_t);
+
+            for (const auto& object : objects)
+                if (object->occluded(r, ray_t)) return true;
+            return false;
+        }
+
+        aabb bounding_box() const override {
+            aabb box = aabb::empty;
+            for (const auto& object : objects)
+                box = aabb(box, object->bounding_box());
+            return box;
         }
 
         bool is_shadowed(const point3& p, const vec3& light_dir) const { 
             ray shadow_ray(p + light_dir * 1e-4, light_dir);
-            hit_record shadow_hit;
-            return hit(shadow_ray, interval(0.001, infinity), shadow_hit);  
+            return occluded(shadow_ray, interval(0.001, infinity));
         }
         
         const vec3& get_light_direction() const { return light_direction;}
-        void set_light_direction(const vec3& light_direction) { 
-            this->light_direction = unit_vector(light_direction); 
+        /** Pass normalize = false only for directions that are already unit length, e.g. when loading a saved scene. */
+        void set_light_direction(const vec3& light_direction, bool normalize = true) { 
+            this->light_direction = normalize ? unit_vector(light_direction) : light_direction; 
         }
 
         const color& get_light_color() const { return light_color; }
@@ -55,6 +88,8 @@ class hittable_list : public hittable {
         void set_background_color(const color& background_color) { this->background_color = background_color; }
 
     private: 
+        shared_ptr<hittable> accelerator;
+
         /** Values needed for calculating material shading */
         vec3 light_direction;
         color light_color;
@@ -0,0 +1,57 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <string>
+
+/**
+ * Encodes an 8-bit RGB image one horizontal stripe at a time, so images never have to be
+ * held in full. begin() sets up the image and returns the file header, encode_stripe()
+ * returns the bytes of one stripe, and finish() the trailer; the output file is their
+ * concatenation in stripe order.
+ *
+ * encode_stripe may be called concurrently for different stripes, in any order.
+ */
+class image_encoder {
+    public:
+        virtual ~image_encoder() = default;
+
+        virtual std::string begin(int width, int height, int stripe_height) = 0;
+
+        /** rgb holds the stripe's rows, 3 bytes per pixel. Every stripe but the last has stripe_height rows. */
+        virtual std::string encode_stripe(int index, const unsigned char* rgb, int rows) = 0;
+
+        virtual std::string finish() = 0;
+};
+
+/** PPM, either binary (P6) or the ASCII form (P3) that camera::render writes. */
+class ppm_encoder : public image_encoder {
+    public:
+        explicit ppm_encoder(bool binary = true) : binary(binary) {}
+
+        std::string begin(int width, int height, int) override {
+            this->width = width;
+            return std::string(binary ? "P6" : "P3") + '\n' + std::to_string(width) + ' '
+                 + std::to_string(height) + "\n255\n";
+        }
+
+        std::string encode_stripe(int, const unsigned char* rgb, int rows) override {
+            size_t bytes = size_t(width) * rows * 3;
+            if (binary) return std::string(reinterpret_cast<const char*>(rgb), bytes);
+
+            std::string text;
+            text.reserve(bytes * 4);
+            for (size_t k = 0; k < bytes; k += 3) {
+                text += std::to_string(rgb[k]) + ' ' + std::to_string(rgb[k + 1]) + ' '
+                      + std::to_string(rgb[k + 2]) + '\n';
+            }
+            return text;
+        }
+
+        std::string finish() override { return ""; }
+
+    private:
+        bool binary;
+        int width = 0;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef IMAGE_FORMATS_H
+#define IMAGE_FORMATS_H
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <string>
+
+#include "framebuffer.h"
+#include "image_encoder.h"
+#include "png_encoder.h"
+#include "qoi_encoder.h"
+
+/** Format name for a filename's extension: "png", "qoi", or "ppm" for anything else. */
+inline std::string image_format_for(const std::string& filename) {
+    std::string extension = filename.substr(std::min(filename.size(), filename.rfind('.') + 1));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+    if (extension == "png" || extension == "qoi") return extension;
+    return "ppm";
+}
+
+/** Encoder for a format name from image_format_for. PPM is the ASCII form camera::render writes. */
+inline std::unique_ptr<image_encoder> make_encoder(const std::string& format) {
+    if (format == "png") return std::make_unique<png_encoder>();
+    if (format == "qoi") return std::make_unique<qoi_encoder>();
+    return std::make_unique<ppm_encoder>(false);
+}
+
+/** Encodes a whole image on the calling thread, stripe_height rows at a time. */
+inline std::string encode_image(const rgb8_image& image, image_encoder& encoder, int stripe_height = 64) {
+    std::string out = encoder.begin(image.width, image.height, stripe_height);
+    const size_t stride = size_t(image.width) * 3;
+    for (int k = 0, y = 0; y < image.height; k++, y += stripe_height) {
+        int rows = std::min(stripe_height, image.height - y);
+        out += encoder.encode_stripe(k, image.pixels.data() + y * stride, rows);
+    }
+    return out + encoder.finish();
+}
+
+#endif
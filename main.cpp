@@ -1,8 +1,10 @@
 #include "rtmath.h"
 
 #include "camera.h"
+#include "frame_cache.h"
 #include "hittable.h"
 #include "hittable_list.h"
+#include "render_queue.h"
 #include "sphere.h"
 #include "triangle.h"
 
@@ -45,6 +47,18 @@ void create_triangle(hittable_list& world, point3 a, point3 b,
 }
 
 int main () {
+    /** Frames already rendered by an earlier run are copied from the cache instead */
+    frame_cache cache("frame_cache", 256ull << 20);
+
+    /** All six images render concurrently on one shared thread pool */
+    render_queue renders;
+    renders.cache = &cache;
+    auto report = [](const render_result& result) {
+        if (result.written)
+            std::clog << "Wrote " + result.filename + (result.cached ? " from cache" : "")
+                       + " in " + std::to_string(result.seconds) + " s\n";
+    };
+
     /** Image 1 */
     hittable_list world1;
     world1.set_light_direction(vec3(0.0, 1.0, 0.0));
@@ -71,7 +85,7 @@ int main () {
     cam1.vfov = 90;
 
 
-    cam1.render(world1, "im1.ppm");
+    renders.submit(world1, cam1, "im1.ppm", report);
 
     /** Image 2 */
     hittable_list world2;
@@ -137,7 +151,7 @@ int main () {
     cam2.look_up = point3(0.0, 1.0, 0.0);
     cam2.vfov = 90;
 
-    cam2.render(world2, "im2.ppm");
+    renders.submit(world2, cam2, "im2.ppm", report);
 
     /** Image 3 */
     hittable_list world3;
@@ -167,7 +181,7 @@ int main () {
     cam3.look_up = point3(0.0, 1.0, 0.0);
     cam3.vfov = 90;
 
-    cam3.render(world3, "im3.ppm");
+    renders.submit(world3, cam3, "im3.ppm", report);
 
     /** Part 2 */
 
@@ -206,7 +220,7 @@ int main () {
     cam4.look_up = point3(0.0, 1.0, 0.0);
     cam4.vfov = 90;
 
-    cam4.render(world4, "im4.ppm");
+    renders.submit(world4, cam4, "im4.ppm", report);
 
     /** Image 5 */
     hittable_list world5;
@@ -258,7 +272,7 @@ int main () {
     cam5.look_up = point3(0.0, 1.0, 0.0);
     cam5.vfov = 90;
 
-    cam5.render(world5, "im5.ppm");
+    renders.submit(world5, cam5, "im5.ppm", report);
 
 
     /** Image 6 */
@@ -341,5 +355,7 @@ int main () {
     custom_cam.look_up = point3(0.0, 1.0, 0.0);
     custom_cam.vfov = 75;
 
-    custom_cam.render(world6, "im6.ppm");
+    renders.submit(world6, custom_cam, "im6.ppm", report);
+
+    renders.wait();
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#ifndef PNG_ENCODER_H
+#define PNG_ENCODER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "deflate.h"
+#include "image_encoder.h"
+
+/**
+ * 8-bit RGB PNG writer. Each stripe is filtered and deflated on its own and becomes one
+ * IDAT chunk, so stripes encode in parallel; the zlib stream's Adler-32 is stitched
+ * together from the per-stripe checksums in finish().
+ *
+ * Rows pick whichever filter gives the smallest sum of absolute residuals. The first row
+ * of a stripe can't see the row above it, so it only tries None and Sub.
+ */
+class png_encoder : public image_encoder {
+    public:
+        std::string begin(int width, int height, int stripe_height) override {
+            this->width = width;
+            int stripe_count = (height + stripe_height - 1) / stripe_height;
+            stripe_adler.assign(stripe_count, 1);
+            stripe_bytes.assign(stripe_count, 0);
+
+            std::string header("\x89PNG\r\n\x1a\n", 8);
+            std::string ihdr = be32(std::uint32_t(width)) + be32(std::uint32_t(height));
+            ihdr += char(8);                 // Bit depth
+            ihdr += char(2);                 // Color type: RGB
+            ihdr += std::string(3, '\0');    // Deflate, adaptive filtering, no interlace
+            return header + chunk("IHDR", ihdr);
+        }
+
+        std::string encode_stripe(int index, const unsigned char* rgb, int rows) override {
+            const size_t stride = size_t(width) * 3;
+            std::vector<unsigned char> raw;
+            raw.reserve(rows * (stride + 1));
+            std::vector<unsigned char> best, trial(stride);
+
+            for (int row = 0; row < rows; row++) {
+                const unsigned char* line = rgb + row * stride;
+                const unsigned char* above = row > 0 ? line - stride : nullptr;
+                int best_filter = -1;
+                long best_cost = 0;
+
+                for (int filter : {0, 1, 2, 4}) {
+                    if (!above && (filter == 2 || filter == 4)) continue;
+                    long cost = 0;
+                    for (size_t k = 0; k < stride; k++) {
+                        int left = k >= 3 ? line[k - 3] : 0;
+                        int up = above ? above[k] : 0;
+                        int up_left = (above && k >= 3) ? above[k - 3] : 0;
+                        int predicted = filter == 0 ? 0 : filter == 1 ? left : filter == 2 ? up
+                                      : paeth(left, up, up_left);
+                        trial[k] = (unsigned char)(line[k] - predicted);
+                        cost += std::abs(int((signed char)trial[k]));
+                    }
+                    if (best_filter < 0 || cost < best_cost) {
+                        best_filter = filter;
+                        best_cost = cost;
+                        best = trial;
+                    }
+                }
+
+                raw.push_back((unsigned char)best_filter);
+                raw.insert(raw.end(), best.begin(), best.end());
+            }
+
+            bool last = index + 1 == int(stripe_adler.size());
+            std::string data = index == 0 ? std::string("\x78\x01", 2) : std::string();
+            data += deflate_compress(raw.data(), raw.size(), last);
+
+            stripe_adler[index] = adler32_update(1, raw.data(), raw.size());
+            stripe_bytes[index] = raw.size();
+            return chunk("IDAT", data);
+        }
+
+        std::string finish() override {
+            std::uint32_t adler = 1;
+            for (size_t k = 0; k < stripe_adler.size(); k++)
+                adler = adler32_combine(adler, stripe_adler[k], stripe_bytes[k]);
+            return chunk("IDAT", be32(adler)) + chunk("IEND", "");
+        }
+
+    private:
+        int width = 0;
+        std::vector<std::uint32_t> stripe_adler;   // Adler-32 of each stripe's filtered bytes
+        std::vector<std::uint64_t> stripe_bytes;   // ...and their count
+
+        static int paeth(int a, int b, int c) {
+            int p = a + b - c;
+            int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+            if (pa <= pb && pa <= pc) return a;
+            return pb <= pc ? b : c;
+        }
+
+        static std::string be32(std::uint32_t v) {
+            return std::string{char(v >> 24), char(v >> 16), char(v >> 8), char(v)};
+        }
+
+        static std::string chunk(const char* type, const std::string& data) {
+            std::string body = std::string(type, 4) + data;
+            std::uint32_t crc = crc32_update(0, reinterpret_cast<const unsigned char*>(body.data()), body.size());
+            return be32(std::uint32_t(data.size())) + body + be32(crc);
+        }
+};
+
+#endif
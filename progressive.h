@@ -0,0 +1,246 @@
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "thread_pool.h"
+
+struct progressive_options {
+    double time_budget_ms = 0;         // Wall-clock budget of one run() call, 0 = none
+    long long ray_budget = 0;          // Primary rays one run() call may trace, 0 = none
+    double snapshot_interval_ms = 50;  // Time between snapshots while running
+    int threads = 0;                   // Worker threads, 0 = one per hardware thread
+
+    /** Snapshot sinks, both optional. Called from the thread that called run(). */
+    std::function<void(const framebuffer&)> on_snapshot;
+    std::string snapshot_file;         // PPM rewritten on every snapshot
+};
+
+/**
+ * Renders a camera's image coarse to fine so a usable preview exists long before the
+ * full image does:
+ *   - level passes: every coarse_step-th pixel, then halving the step down to 1, each
+ *     pass only tracing the pixels the coarser ones skipped;
+ *   - sample passes: one more sample for every pixel, until samples_per_pixel is reached.
+ *
+ * run() stops once its budget is spent and picks up where it left off when called again.
+ * Once complete() the image is bit-identical to what camera::render writes, since every
+ * pixel accumulates the same samples in the same order.
+ */
+class progressive_renderer {
+    public:
+        /**
+         * coarse_step must be a power of two, or level passes would trace some pixels twice;
+         * other values are rounded down to one. cam and world must outlive the renderer.
+         */
+        progressive_renderer(camera& cam, const hittable_list& world, int coarse_step = 16)
+            : cam(cam), world(world), coarse_step(1) {
+            while (this->coarse_step * 2 <= coarse_step)
+                this->coarse_step *= 2;
+            if (this->coarse_step != coarse_step && cam.verbose)
+                std::cerr << "Warning: coarse step " << coarse_step << " is not a power of two, using "
+                          << this->coarse_step << ".\n";
+            cam.initialize();
+            width = cam.image_width;
+            height = cam.get_image_height();
+
+            level_count = 1;
+            for (int step = this->coarse_step; step > 1; step /= 2)
+                level_count++;
+            pass_count = level_count + std::max(0, cam.samples_per_pixel - 1);
+
+            accum.assign(size_t(width) * height, color(0, 0, 0));
+            samples.assign(size_t(width) * height, 0);
+            unit_done.assign(unit_count(), 0);
+        }
+
+        bool complete() const { return pass >= pass_count; }
+
+        /** Fraction of the passes finished, for progress displays. */
+        double progress() const { return double(pass) / pass_count; }
+
+        /** Renders until complete or out of budget. Returns complete(). */
+        bool run(const progressive_options& options) {
+            using clock = std::chrono::steady_clock;
+            auto start = clock::now();
+            auto interval = std::chrono::duration<double, std::milli>(
+                options.snapshot_interval_ms > 0 ? options.snapshot_interval_ms : 1e9);
+            auto next_snapshot = start + std::chrono::duration_cast<clock::duration>(interval);
+
+            int thread_count = resolve_thread_count(options.threads);
+            thread_pool pool(thread_count);
+
+            std::atomic<long long> rays_traced{0};
+            std::atomic<bool> out_of_budget{false};
+            auto budget_spent = [&]() {
+                if (options.ray_budget > 0 && rays_traced >= options.ray_budget) return true;
+                if (options.time_budget_ms > 0) {
+                    std::chrono::duration<double, std::milli> elapsed = clock::now() - start;
+                    if (elapsed.count() >= options.time_budget_ms) return true;
+                }
+                return false;
+            };
+
+            while (!complete() && !out_of_budget) {
+                std::vector<int> pending;
+                for (int u = 0; u < unit_count(); u++)
+                    if (!unit_done[u]) pending.push_back(u);
+
+                std::atomic<size_t> next_unit{0};
+                int active = thread_count;
+                std::condition_variable finished;
+
+                auto worker = [&]() {
+                    std::vector<std::pair<size_t, color>> traced;
+                    std::vector<const hittable*> candidates;
+                    for (;;) {
+                        if (budget_spent()) {
+                            out_of_budget = true;
+                            break;
+                        }
+                        size_t k = next_unit++;
+                        if (k >= pending.size()) break;
+
+                        traced.clear();
+                        trace_unit(pending[k], traced, candidates);
+
+                        /** Only the merge holds the lock, so snapshots never wait on tracing. */
+                        {
+                            std::lock_guard<std::mutex> lock(mtx);
+                            for (const auto& [index, sample] : traced) {
+                                accum[index] += sample;
+                                samples[index]++;
+                            }
+                            unit_done[pending[k]] = 1;
+                        }
+                        rays_traced += (long long)traced.size();
+                    }
+
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (--active == 0) finished.notify_all();
+                };
+
+                for (int t = 0; t < thread_count; t++)
+                    pool.submit(worker);
+
+                for (;;) {
+                    {
+                        std::unique_lock<std::mutex> lock(mtx);
+                        if (finished.wait_until(lock, next_snapshot, [&] { return active == 0; }))
+                            break;
+                    }
+                    publish(options);
+                    next_snapshot = clock::now() + std::chrono::duration_cast<clock::duration>(interval);
+                }
+
+                pool.wait_idle();
+
+                if (std::all_of(unit_done.begin(), unit_done.end(), [](char d) { return d != 0; })) {
+                    pass++;
+                    unit_done.assign(unit_count(), 0);
+                }
+            }
+
+            publish(options);
+            return complete();
+        }
+
+        /**
+         * Current image. Pixels not traced yet borrow the color of the closest coarser pixel
+         * that has been, so early snapshots look blocky rather than sparse. The lock is taken
+         * one band of rows at a time, so workers merging their results wait for at most one
+         * band's copy.
+         */
+        framebuffer snapshot() const {
+            framebuffer image(width, height);
+            std::vector<char> traced(size_t(width) * height, 0);
+            for (int band = 0; band < unit_count(); band++) {
+                int row_end = std::min(height, (band + 1) * rows_per_unit);
+                std::lock_guard<std::mutex> lock(mtx);
+                for (int j = band * rows_per_unit; j < row_end; j++) {
+                    for (int i = 0; i < width; i++) {
+                        size_t index = size_t(j) * width + i;
+                        if (samples[index] > 0) {
+                            image.at(i, j) = accum[index] / samples[index];
+                            traced[index] = 1;
+                        }
+                    }
+                }
+            }
+
+            for (int j = 0; j < height; j++) {
+                for (int i = 0; i < width; i++) {
+                    if (traced[size_t(j) * width + i]) continue;
+                    for (int step = 2; step <= coarse_step; step *= 2) {
+                        int pi = i - i % step, pj = j - j % step;
+                        if (traced[size_t(pj) * width + pi]) {
+                            image.at(i, j) = image.at(pi, pj);
+                            break;
+                        }
+                    }
+                }
+            }
+            return image;
+        }
+
+    private:
+        static const int rows_per_unit = 8;  // Work is handed out in bands of image rows
+
+        const camera& cam;
+        const hittable_list& world;
+        int width, height;
+        int coarse_step;
+        int level_count;                     // Passes that add pixels
+        int pass_count;                      // Level passes plus sample passes
+        int pass = 0;                        // Pass currently being rendered
+
+        std::vector<color> accum;            // Sum of the samples traced per pixel
+        std::vector<int> samples;            // Samples traced per pixel
+        std::vector<char> unit_done;         // Bands of the current pass already merged
+        mutable std::mutex mtx;
+
+        int unit_count() const { return (height + rows_per_unit - 1) / rows_per_unit; }
+
+        /** Whether pixel (i, j) is traced by the current pass. */
+        bool in_pass(int i, int j) const {
+            if (pass >= level_count) return true;
+            int step = coarse_step >> pass;
+            if (i % step != 0 || j % step != 0) return false;
+            if (pass == 0) return true;
+            return i % (2 * step) != 0 || j % (2 * step) != 0;
+        }
+
+        void trace_unit(int unit, std::vector<std::pair<size_t, color>>& traced,
+                        std::vector<const hittable*>& candidates) const {
+            int sample = pass < level_count ? 0 : pass - level_count + 1;
+            int row_begin = unit * rows_per_unit, row_end = std::min(height, (unit + 1) * rows_per_unit);
+            const auto* primary = cam.primary_candidates(world, {0, row_begin, width, row_end}, candidates)
+                                ? &candidates : nullptr;
+            for (int j = row_begin; j < row_end; j++) {
+                for (int i = 0; i < width; i++) {
+                    if (in_pass(i, j))
+                        traced.emplace_back(size_t(j) * width + i, cam.sample_color(world, i, j, sample, primary));
+                }
+            }
+        }
+
+        void publish(const progressive_options& options) const {
+            if (!options.on_snapshot && options.snapshot_file.empty()) return;
+
+            framebuffer image = snapshot();
+            if (options.on_snapshot) options.on_snapshot(image);
+            if (!options.snapshot_file.empty()) image.write_ppm(options.snapshot_file);
+        }
+};
+
+#endif
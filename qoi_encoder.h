@@ -0,0 +1,97 @@
+#ifndef QOI_ENCODER_H
+#define QOI_ENCODER_H
+
+#include <cstdint>
+#include <string>
+
+#include "image_encoder.h"
+
+/**
+ * QOI ("Quite OK Image") writer, RGB with sRGB tag.
+ *
+ * A QOI decoder carries its previous pixel and 64-entry color index across the whole
+ * image, which stripes encoded in parallel can't know. Each stripe therefore starts with
+ * a full QOI_OP_RGB pixel and only refers to index entries written within the same stripe;
+ * the decoder holds exactly those values in those entries, so the output stays valid.
+ */
+class qoi_encoder : public image_encoder {
+    public:
+        std::string begin(int width, int height, int) override {
+            this->width = width;
+            std::string header = "qoif" + be32(std::uint32_t(width)) + be32(std::uint32_t(height));
+            header += char(3);     // Channels
+            header += char(0);     // sRGB with linear alpha
+            return header;
+        }
+
+        std::string encode_stripe(int, const unsigned char* rgb, int rows) override {
+            const unsigned char op_index = 0x00, op_diff = 0x40, op_luma = 0x80, op_run = 0xc0, op_rgb = 0xfe;
+
+            std::string out;
+            unsigned char index[64][3] = {};
+            bool index_valid[64] = {};
+            unsigned char previous[3] = {0, 0, 0};
+            int run = 0;
+            const size_t pixels = size_t(width) * rows;
+
+            for (size_t n = 0; n < pixels; n++) {
+                const unsigned char* px = rgb + 3 * n;
+                bool same = n > 0 && px[0] == previous[0] && px[1] == previous[1] && px[2] == previous[2];
+
+                if (same) {
+                    if (++run == 62) {
+                        out += char(op_run | (run - 1));
+                        run = 0;
+                    }
+                    continue;
+                }
+                if (run > 0) {
+                    out += char(op_run | (run - 1));
+                    run = 0;
+                }
+
+                int slot = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+                signed char dr = (signed char)(px[0] - previous[0]);
+                signed char dg = (signed char)(px[1] - previous[1]);
+                signed char db = (signed char)(px[2] - previous[2]);
+                signed char dr_dg = (signed char)(dr - dg), db_dg = (signed char)(db - dg);
+
+                if (n == 0) {
+                    out += char(op_rgb);
+                    out.append(reinterpret_cast<const char*>(px), 3);
+                } else if (index_valid[slot] && index[slot][0] == px[0] && index[slot][1] == px[1]
+                           && index[slot][2] == px[2]) {
+                    out += char(op_index | slot);
+                } else if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    out += char(op_diff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    out += char(op_luma | (dg + 32));
+                    out += char(((dr_dg + 8) << 4) | (db_dg + 8));
+                } else {
+                    out += char(op_rgb);
+                    out.append(reinterpret_cast<const char*>(px), 3);
+                }
+
+                index[slot][0] = px[0];
+                index[slot][1] = px[1];
+                index[slot][2] = px[2];
+                index_valid[slot] = true;
+                previous[0] = px[0];
+                previous[1] = px[1];
+                previous[2] = px[2];
+            }
+            if (run > 0) out += char(op_run | (run - 1));
+            return out;
+        }
+
+        std::string finish() override { return std::string("\0\0\0\0\0\0\0\x01", 8); }
+
+    private:
+        int width = 0;
+
+        static std::string be32(std::uint32_t v) {
+            return std::string{char(v >> 24), char(v >> 16), char(v >> 8), char(v)};
+        }
+};
+
+#endif
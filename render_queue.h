@@ -0,0 +1,185 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+#include "frame_cache.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "image_formats.h"
+#include "thread_pool.h"
+#include "tile.h"
+
+struct render_result {
+    int job_id;
+    std::string filename;
+    bool written;             // False if the output file could not be written
+    bool cached;              // Served from the frame cache without tracing
+    double seconds;           // From submit() to the file being written
+};
+
+/**
+ * Batch renderer: any number of (world, camera, output file) jobs share one thread pool.
+ * The output format follows the file extension: .png, .qoi, or PPM for anything else.
+ * Every job is cut into tiles that go onto the pool's queue as soon as it is submitted,
+ * so while the last tiles of one image are finishing the free cores already work on the
+ * next. PNG and QOI images are encoded one stripe per row of tiles, by the worker that
+ * finishes the row, so encoding runs in parallel with tracing; the worker finishing the
+ * last row joins the stripes, writes the file and runs its callback. No other worker
+ * waits on that.
+ *
+ * Worlds are only read, so one world can back any number of jobs.
+ *
+ * With a frame cache attached, a job whose world and camera were rendered before is
+ * served from the cache and never traced.
+ */
+class render_queue {
+    public:
+        int tile_size = 32;             // Edge length of the square tiles jobs are cut into
+        frame_cache* cache = nullptr;   // Optional, must outlive the queue
+
+        explicit render_queue(int threads = 0) : pool(threads) {}
+
+        /** Waits for every submitted job. */
+        ~render_queue() { wait(); }
+
+        /**
+         * Queues a render of world through cam into filename. on_complete, if set, is
+         * called from a worker thread once the file has been written. Returns the job id.
+         */
+        int submit(shared_ptr<const hittable_list> world, camera cam, const std::string& filename,
+                   std::function<void(const render_result&)> on_complete = nullptr) {
+            auto job = make_shared<render_job>();
+            job->id = next_id++;
+            job->start = std::chrono::steady_clock::now();
+            job->filename = filename;
+            job->on_complete = std::move(on_complete);
+
+            if (cache) job->cache_key = frame_key(*world, cam, image_format_for(filename));
+            if (!job->cache_key.empty()) {
+                std::string frame;
+                if (cache->lookup(job->cache_key, frame)) {
+                    pool.submit([job, frame = std::move(frame)] {
+                        report(*job, write_file_atomic(job->filename, frame), true);
+                    });
+                    return job->id;
+                }
+            }
+
+            job->world = std::move(world);
+            job->cam = cam;
+            job->cam.initialize();
+            int width = job->cam.image_width, height = job->cam.get_image_height();
+            job->image = framebuffer(width, height);
+
+            std::vector<tile> tiles = make_tiles(width, height, tile_size);
+            int tiles_per_row = (width + tile_size - 1) / tile_size;
+            int row_count = (height + tile_size - 1) / tile_size;
+            job->tiles_left = std::vector<std::atomic<int>>(size_t(row_count));
+            for (auto& left : job->tiles_left)
+                left = tiles_per_row;
+            job->rows_left = row_count;
+
+            std::string format = image_format_for(filename);
+            if (format != "ppm") {
+                job->encoder = make_encoder(format);
+                job->header = job->encoder->begin(width, height, tile_size);
+                job->stripes.resize(size_t(row_count));
+            }
+
+            for (const auto& t : tiles) {
+                pool.submit([job, t, row_height = tile_size, cache = cache] {
+                    job->cam.render_tile(*job->world, job->image, t);
+                    int row = t.y0 / row_height;
+                    if (--job->tiles_left[row] > 0) return;
+                    if (job->encoder) encode_row(*job, row, t.y0, t.y1);
+                    if (--job->rows_left == 0) finish(*job, cache);
+                });
+            }
+            return job->id;
+        }
+
+        /** Same as above for a world owned by the caller, which must outlive the job. */
+        int submit(const hittable_list& world, camera cam, const std::string& filename,
+                   std::function<void(const render_result&)> on_complete = nullptr) {
+            return submit(shared_ptr<const hittable_list>(shared_ptr<const hittable_list>(), &world),
+                          cam, filename, std::move(on_complete));
+        }
+
+        /** Blocks until every job submitted so far has been written. */
+        void wait() { pool.wait_idle(); }
+
+    private:
+        struct render_job {
+            int id;
+            shared_ptr<const hittable_list> world;
+            camera cam;
+            std::string filename;
+            std::string cache_key;
+            std::function<void(const render_result&)> on_complete;
+            framebuffer image;
+            std::vector<std::atomic<int>> tiles_left;   // Per row of tiles
+            std::atomic<int> rows_left;                 // Rows of tiles not yet rendered and encoded
+            std::unique_ptr<image_encoder> encoder;     // Null for PPM
+            std::string header;
+            std::vector<std::string> stripes;           // Encoded, one per row of tiles
+            std::chrono::steady_clock::time_point start;
+        };
+
+        thread_pool pool;
+        std::atomic<int> next_id{0};
+
+        /** Quantizes and encodes the image rows [y0, y1), which make up row of tiles number row. */
+        static void encode_row(render_job& job, int row, int y0, int y1) {
+            std::vector<unsigned char> rgb;
+            rgb.reserve(size_t(job.image.get_width()) * (y1 - y0) * 3);
+            for (int j = y0; j < y1; j++) {
+                for (int i = 0; i < job.image.get_width(); i++) {
+                    const color& pixel = job.image.at(i, j);
+                    rgb.push_back(color_to_byte(pixel.x()));
+                    rgb.push_back(color_to_byte(pixel.y()));
+                    rgb.push_back(color_to_byte(pixel.z()));
+                }
+            }
+            job.stripes[row] = job.encoder->encode_stripe(row, rgb.data(), y1 - y0);
+        }
+
+        static void finish(render_job& job, frame_cache* cache) {
+            std::string frame;
+            if (!job.encoder) {
+                frame = job.image.encode_ppm();  // Exactly what camera::render writes, unclamped
+            } else {
+                size_t size = job.header.size();
+                for (const auto& stripe : job.stripes)
+                    size += stripe.size();
+                std::string trailer = job.encoder->finish();
+                frame.reserve(size + trailer.size());
+                frame += job.header;
+                for (const auto& stripe : job.stripes)
+                    frame += stripe;
+                frame += trailer;
+            }
+            if (cache && !job.cache_key.empty()) cache->store(job.cache_key, frame);
+            report(job, write_file_atomic(job.filename, frame), false);
+        }
+
+        static void report(render_job& job, bool written, bool cached) {
+            render_result result;
+            result.job_id = job.id;
+            result.filename = job.filename;
+            result.written = written;
+            result.cached = cached;
+            result.seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - job.start).count();
+
+            if (job.on_complete) job.on_complete(result);
+        }
+};
+
+#endif
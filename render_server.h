@@ -0,0 +1,222 @@
+#ifndef RENDER_SERVER_H
+#define RENDER_SERVER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <poll.h>
+
+#include "framebuffer.h"
+#include "render_service.h"
+#include "scene_io.h"
+#include "socket_io.h"
+
+/**
+ * Local socket front end for render_service (POSIX only).
+ *
+ * A request is one header line followed by a scene in the scene_io text form:
+ *
+ *   render <priority> <channel, or - for none>
+ *   ...scene records...
+ *   end
+ *
+ * The reply is "ok <width> <height>\n" followed by width * height * 3 bytes of 8-bit RGB,
+ * "cancelled\n" if a newer request on the same channel superseded it, or
+ * "error <message>\n". A client that hangs up before its reply cancels its render.
+ */
+
+class render_server {
+    public:
+        size_t max_scene_bytes = 16 << 20;  // Longest request line and scene a client may send
+        double receive_timeout = 30;        // Seconds a client may pause while sending its request
+
+        render_server(render_service& service, const std::string& socket_path)
+            : service(service), socket_path(socket_path) {}
+
+        ~render_server() { stop(); }
+
+        /** Binds the socket and starts accepting on a background thread. */
+        bool start(std::string& error) {
+            sockaddr_un address;
+            if (!socket_io::make_address(socket_path, address)) {
+                error = "socket path too long: " + socket_path;
+                return false;
+            }
+
+            listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            ::unlink(socket_path.c_str());
+            if (listen_fd < 0
+                || ::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+                || ::listen(listen_fd, 16) < 0) {
+                error = "could not listen on " + socket_path;
+                if (listen_fd >= 0) ::close(listen_fd);
+                listen_fd = -1;
+                return false;
+            }
+
+            acceptor = std::thread([this] { accept_loop(); });
+            return true;
+        }
+
+        /** Stops accepting, hangs up on open connections (cancelling their renders) and waits for them. */
+        void stop() {
+            if (listen_fd < 0) return;
+
+            ::shutdown(listen_fd, SHUT_RDWR);
+            acceptor.join();
+            ::close(listen_fd);
+            listen_fd = -1;
+            ::unlink(socket_path.c_str());
+
+            std::unique_lock<std::mutex> lock(mtx);
+            for (int fd : connections)
+                ::shutdown(fd, SHUT_RDWR);
+            all_closed.wait(lock, [this] { return connections.empty(); });
+        }
+
+    private:
+        render_service& service;
+        std::string socket_path;
+        int listen_fd = -1;
+        std::thread acceptor;
+
+        std::mutex mtx;
+        std::condition_variable all_closed;
+        std::set<int> connections;
+
+        void accept_loop() {
+            for (;;) {
+                int fd = ::accept(listen_fd, nullptr, nullptr);
+                if (fd < 0) return;
+
+                std::lock_guard<std::mutex> lock(mtx);
+                connections.insert(fd);
+                std::thread([this, fd] { serve(fd); }).detach();
+            }
+        }
+
+        void serve(int fd) {
+            std::string reply;
+            try {
+                reply = handle_request(fd);
+            } catch (const std::bad_alloc&) {
+                reply = "error out of memory\n";
+            } catch (const std::exception& e) {
+                reply = std::string("error ") + e.what() + '\n';
+            }
+            if (!reply.empty()) socket_io::send_all(fd, reply.data(), reply.size());
+
+            // Forget fd before closing it: once closed, accept() may hand the same number out again
+            std::lock_guard<std::mutex> lock(mtx);
+            connections.erase(fd);
+            ::close(fd);
+            if (connections.empty()) all_closed.notify_all();
+        }
+
+        std::string handle_request(int fd) {
+            socket_io::set_receive_timeout(fd, receive_timeout);
+            std::string line;
+            if (!socket_io::recv_line(fd, line, max_scene_bytes)) return "";
+
+            std::istringstream header(line);
+            std::string command, channel;
+            int priority = 0;
+            if (!(header >> command >> priority >> channel) || command != "render")
+                return "error expected 'render <priority> <channel>'\n";
+            if (channel == "-") channel.clear();
+
+            std::string scene_text;
+            std::string too_long = "error scene longer than " + std::to_string(max_scene_bytes) + " bytes\n";
+            do {
+                if (scene_text.size() >= max_scene_bytes) return too_long;
+                size_t room = max_scene_bytes - scene_text.size() - 1;  // Less the '\n'
+                if (!socket_io::recv_line(fd, line, room))
+                    return line.size() == room ? too_long : "error scene ended early\n";
+                scene_text += line + '\n';
+            } while (line != "end");
+
+            /**
+             * read_scene also rejects camera settings that can't be rendered, e.g. a negative
+             * width, and, with the default limits, ones too large to serve.
+             */
+            auto world = make_shared<hittable_list>();
+            camera cam;
+            std::string error;
+            std::istringstream scene(scene_text);
+            if (!read_scene(scene, *world, cam, error))
+                return "error " + error + '\n';
+
+            render_handle handle = service.submit(world, cam, priority, channel);
+
+            /** Poll for a hang-up while waiting, so abandoned requests stop using cores. */
+            while (!handle.wait_for(std::chrono::milliseconds(20))) {
+                pollfd watch{fd, POLLIN, 0};
+                char probe;
+                if (::poll(&watch, 1, 0) > 0
+                    && ((watch.revents & (POLLHUP | POLLERR)) || ::recv(fd, &probe, 1, MSG_PEEK) <= 0)) {
+                    handle.cancel();
+                    return "";
+                }
+            }
+
+            const framebuffer* image = handle.get();
+            if (!image) return "cancelled\n";
+
+            rgb8_image rgb = image->quantize();
+            std::string reply = "ok " + std::to_string(rgb.width) + ' ' + std::to_string(rgb.height) + '\n';
+            reply.append(reinterpret_cast<const char*>(rgb.pixels.data()), rgb.pixels.size());
+            return reply;
+        }
+};
+
+/**
+ * Stand-in client: sends one request to a render_server and waits for the image.
+ * On failure returns false and sets error.
+ */
+inline bool request_render(const std::string& socket_path, const std::string& scene_text,
+                           int priority, const std::string& channel,
+                           rgb8_image& image, std::string& error) {
+    sockaddr_un address;
+    if (!socket_io::make_address(socket_path, address)) {
+        error = "socket path too long: " + socket_path;
+        return false;
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        if (fd >= 0) ::close(fd);
+        error = "could not connect to " + socket_path;
+        return false;
+    }
+
+    std::string request = "render " + std::to_string(priority) + ' '
+                        + (channel.empty() ? "-" : channel) + '\n' + scene_text;
+    std::string status;
+    bool ok = socket_io::send_all(fd, request.data(), request.size())
+           && socket_io::recv_line(fd, status);
+
+    if (ok) {
+        std::istringstream reply(status);
+        std::string word;
+        reply >> word;
+        if (word == "ok" && reply >> image.width >> image.height) {
+            image.pixels.resize(size_t(image.width) * image.height * 3);
+            ok = socket_io::recv_all(fd, image.pixels.data(), image.pixels.size());
+            if (!ok) error = "connection closed mid-image";
+        } else {
+            error = status;
+            ok = false;
+        }
+    } else {
+        error = "connection closed";
+    }
+
+    ::close(fd);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef RENDER_SERVICE_H
+#define RENDER_SERVICE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "thread_pool.h"
+#include "tile.h"
+
+enum class render_status { running, done, cancelled };
+
+/** State of one asynchronous render, shared by its handle and its queued tiles. */
+class render_task {
+    public:
+        render_task(int id, shared_ptr<const hittable_list> world, const camera& cam)
+            : id(id), world(std::move(world)), cam(cam) {}
+
+        const int id;
+        const shared_ptr<const hittable_list> world;
+        camera cam;
+        framebuffer image;
+        std::atomic<int> tiles_done{0};
+        int tile_count = 0;
+
+        /** Checked before every tile, so cancelling frees the cores within one tile's time. */
+        std::atomic<bool> cancel_requested{false};
+
+        render_status status() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return current;
+        }
+
+        /** Moves a running task to done or cancelled and wakes its waiters. */
+        void settle(render_status outcome) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (current != render_status::running) return;
+                current = outcome;
+            }
+            settled.notify_all();
+        }
+
+        bool wait_for(std::chrono::milliseconds timeout) const {
+            std::unique_lock<std::mutex> lock(mtx);
+            return settled.wait_for(lock, timeout, [this] { return current != render_status::running; });
+        }
+
+        void wait() const {
+            std::unique_lock<std::mutex> lock(mtx);
+            settled.wait(lock, [this] { return current != render_status::running; });
+        }
+
+    private:
+        mutable std::mutex mtx;
+        mutable std::condition_variable settled;
+        render_status current = render_status::running;
+};
+
+/** Caller's view of a submitted render. Cheap to copy; all copies refer to the same render. */
+class render_handle {
+    public:
+        render_handle() {}
+        explicit render_handle(shared_ptr<render_task> task) : task(std::move(task)) {}
+
+        bool valid() const { return task != nullptr; }
+        int id() const { return task->id; }
+        render_status status() const { return task->status(); }
+
+        /** Fraction of tiles rendered, 0 to 1. */
+        double progress() const {
+            return task->tile_count == 0 ? 1.0 : double(task->tiles_done) / task->tile_count;
+        }
+
+        /** Tiles already queued are skipped; tiles being traced finish first. */
+        void cancel() const {
+            task->cancel_requested = true;
+            task->settle(render_status::cancelled);
+        }
+
+        /** Waits up to timeout; returns true once the render is done or cancelled. */
+        bool wait_for(std::chrono::milliseconds timeout) const { return task->wait_for(timeout); }
+
+        /** Blocks until the render settles. Returns the image, or nullptr if it was cancelled. */
+        const framebuffer* get() const {
+            task->wait();
+            return task->status() == render_status::done ? &task->image : nullptr;
+        }
+
+    private:
+        shared_ptr<render_task> task;
+};
+
+/**
+ * Non-blocking renderer for embedding in long-running programs. submit() returns at once
+ * with a handle for progress, cancellation and the in-memory result; nothing is printed
+ * and nothing is written to disk.
+ *
+ * Tiles of higher priority renders jump ahead of queued lower priority tiles. A render
+ * submitted on a channel supersedes (cancels) the previous render on the same channel,
+ * e.g. an interactive view that was moved before its last frame finished.
+ */
+class render_service {
+    public:
+        int tile_size = 32;   // Edge length of the square tiles renders are cut into
+
+        explicit render_service(int threads = 0) : pool(threads) {}
+
+        /** Cancels every unfinished render, then waits for the tiles still being traced. */
+        ~render_service() {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                for (auto& [id, task] : live)
+                    if (auto running = task.lock()) render_handle(running).cancel();
+            }
+            pool.wait_idle();
+        }
+
+        render_handle submit(shared_ptr<const hittable_list> world, camera cam,
+                             int priority = 0, const std::string& channel = "") {
+            cam.verbose = false;
+            cam.initialize();
+
+            auto task = make_shared<render_task>(next_id++, std::move(world), cam);
+            task->image = framebuffer(cam.image_width, cam.get_image_height());
+            std::vector<tile> tiles = make_tiles(task->image.get_width(), task->image.get_height(), tile_size);
+            task->tile_count = int(tiles.size());
+
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                for (auto it = live.begin(); it != live.end();)
+                    it = it->second.expired() ? live.erase(it) : std::next(it);
+                live[task->id] = task;
+
+                if (!channel.empty()) {
+                    if (auto previous = channels[channel].lock())
+                        render_handle(previous).cancel();
+                    channels[channel] = task;
+                }
+            }
+
+            if (tiles.empty()) task->settle(render_status::done);
+            for (const auto& t : tiles) {
+                pool.submit([task, t] {
+                    if (task->cancel_requested) return;
+                    task->cam.render_tile(*task->world, task->image, t);
+                    if (++task->tiles_done == task->tile_count)
+                        task->settle(render_status::done);
+                }, priority);
+            }
+            return render_handle(task);
+        }
+
+    private:
+        thread_pool pool;
+        std::atomic<int> next_id{0};
+        std::mutex mtx;
+        std::map<int, std::weak_ptr<render_task>> live;
+        std::map<std::string, std::weak_ptr<render_task>> channels;
+};
+
+#endif
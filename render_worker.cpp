@@ -0,0 +1,17 @@
+#include <cstdlib>
+
+#include "distributed.h"
+
+/** Standalone render worker for render_coordinator::connect_worker. Usage: render_worker <port> */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <port>\n";
+        return 1;
+    }
+
+    int port = std::atoi(argv[1]);
+    if (!serve_render_worker(port)) {
+        std::cerr << "Error: could not listen on port " << port << ".\n";
+        return 1;
+    }
+}
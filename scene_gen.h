@@ -0,0 +1,216 @@
+#ifndef SCENE_GEN_H
+#define SCENE_GEN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "rtmath.h"
+#include "arena.h"
+#include "camera.h"
+#include "hittable_list.h"
+#include "sphere.h"
+#include "triangle.h"
+
+/**
+ * Seeded generators for large stress scenes, used to measure how intersection cost scales
+ * with object count. The same seed always produces the same scene on every platform, since
+ * the random numbers come from splitmix64 rather than std:: distributions. Each draw is
+ * taken into its own variable: the order function arguments are evaluated in is up to the
+ * compiler, so two draws in one call would differ between GCC and Clang.
+ *
+ * Objects are allocated from a scene_arena, and materials come from a small shared palette.
+ */
+
+/** splitmix64: tiny, fast, and identical everywhere. */
+class scene_rng {
+    public:
+        explicit scene_rng(std::uint64_t seed) : state(seed) {}
+
+        std::uint64_t next() {
+            std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        /** Uniform in [0, 1). */
+        double uniform() { return double(next() >> 11) * 0x1.0p-53; }
+        double uniform(double min, double max) { return min + (max - min) * uniform(); }
+
+        vec3 in_box(double half_size) {
+            double x = uniform(-half_size, half_size);
+            double y = uniform(-half_size, half_size);
+            double z = uniform(-half_size, half_size);
+            return vec3(x, y, z);
+        }
+
+    private:
+        std::uint64_t state;
+};
+
+struct stress_scene {
+    hittable_list world;
+    camera cam;
+};
+
+/** Palette of count random Phong materials, all with the given reflection factor. */
+inline std::vector<shared_ptr<material>> random_palette(scene_rng& rng, int count, double reflection) {
+    std::vector<shared_ptr<material>> palette;
+    for (int k = 0; k < count; k++) {
+        auto mat = make_shared<material>();
+        mat->diffuse_ref_coef = rng.uniform(0.5, 0.9);
+        mat->specular_ref_coef = rng.uniform(0.1, 0.5);
+        mat->ambient_ref_coef = 0.1;
+        double red = rng.uniform(0.2, 1.0);
+        double green = rng.uniform(0.2, 1.0);
+        double blue = rng.uniform(0.2, 1.0);
+        mat->diffuse_color = color(red, green, blue);
+        mat->specular_highlight_color = color(1.0, 1.0, 1.0);
+        mat->glossiness = rng.uniform(4.0, 64.0);
+        mat->reflection_factor = reflection;
+        palette.push_back(mat);
+    }
+    return palette;
+}
+
+inline void set_stress_lighting(hittable_list& world) {
+    world.set_light_direction(vec3(1.0, 1.0, 0.5));
+    world.set_light_color(color(1.0, 1.0, 1.0));
+    world.set_ambient_light(color(0.2, 0.2, 0.2));
+    world.set_background_color(color(0.53, 0.81, 0.92));
+}
+
+inline camera stress_camera(const point3& look_from, const point3& look_at, double vfov) {
+    camera cam;
+    cam.aspect_ratio = 16.0 / 9.0;
+    cam.image_width = 400;
+    cam.look_from = look_from;
+    cam.look_at = look_at;
+    cam.look_up = vec3(0, 1, 0);
+    cam.vfov = vfov;
+    return cam;
+}
+
+/** count spheres on a jittered grid filling the cube [-1, 1]^3. */
+inline stress_scene sphere_field(long count, std::uint64_t seed) {
+    stress_scene scene;
+    scene_rng rng(seed);
+    scene_arena arena;
+    auto palette = random_palette(rng, 16, 0.1);
+    set_stress_lighting(scene.world);
+    scene.world.objects.reserve(size_t(count));
+
+    long side = std::max(1L, long(std::ceil(std::cbrt(double(count)))));
+    double spacing = 2.0 / side;
+    for (long n = 0; n < count; n++) {
+        long x = n % side, y = (n / side) % side, z = n / (side * side);
+        point3 cell(-1 + (x + 0.5) * spacing, -1 + (y + 0.5) * spacing, -1 + (z + 0.5) * spacing);
+        point3 center = cell + rng.in_box(0.2 * spacing);
+        double radius = rng.uniform(0.1, 0.3) * spacing;
+        scene.world.add(arena.make<sphere>(center, radius, palette[rng.next() % palette.size()]));
+    }
+
+    scene.cam = stress_camera(point3(0, 0, 3), point3(0, 0, 0), 60);
+    return scene;
+}
+
+/** count small random triangles in the cube [-1, 1]^3, sized so the soup stays about as dense at any count. */
+inline stress_scene triangle_soup(long count, std::uint64_t seed) {
+    stress_scene scene;
+    scene_rng rng(seed);
+    scene_arena arena;
+    auto palette = random_palette(rng, 16, 0.0);
+    set_stress_lighting(scene.world);
+    scene.world.objects.reserve(size_t(count));
+
+    double size = 1.5 / std::cbrt(double(std::max(1L, count)));
+    for (long n = 0; n < count; n++) {
+        point3 centroid = rng.in_box(1.0);
+        point3 a = centroid + rng.in_box(size);
+        point3 b = centroid + rng.in_box(size);
+        point3 c = centroid + rng.in_box(size);
+        auto mat = palette[rng.next() % palette.size()];
+        scene.world.add(arena.make<triangle>(a, b, c, mat));
+    }
+
+    scene.cam = stress_camera(point3(0, 0, 3), point3(0, 0, 0), 60);
+    return scene;
+}
+
+/** A ground plane 2000 units across with count spheres and triangles scattered near the camera. */
+inline stress_scene ground_clutter(long count, std::uint64_t seed) {
+    stress_scene scene;
+    scene_rng rng(seed);
+    scene_arena arena;
+    auto palette = random_palette(rng, 16, 0.2);
+    set_stress_lighting(scene.world);
+    scene.world.objects.reserve(size_t(count) + 2);
+
+    auto ground = random_palette(rng, 1, 0.0)[0];
+    ground->diffuse_color = color(0.5, 0.5, 0.5);
+    const double extent = 1000.0;
+    scene.world.add(arena.make<triangle>(point3(-extent, 0, -extent), point3(-extent, 0, extent),
+                                         point3(extent, 0, extent), ground));
+    scene.world.add(arena.make<triangle>(point3(-extent, 0, -extent), point3(extent, 0, extent),
+                                         point3(extent, 0, -extent), ground));
+
+    double spread = 2.0 * std::sqrt(double(std::max(1L, count)));
+    for (long n = 0; n < count; n++) {
+        double x = rng.uniform(-spread, spread);
+        double z = rng.uniform(-spread, spread);
+        point3 base(x, 0, z);
+        auto mat = palette[rng.next() % palette.size()];
+        double size = rng.uniform(0.2, 0.6);
+        if (n % 2 == 0) {
+            scene.world.add(arena.make<sphere>(base + vec3(0, size, 0), size, mat));
+        } else {
+            scene.world.add(arena.make<triangle>(base + vec3(-size, 0, 0), base + vec3(size, 0, 0),
+                                                 base + vec3(0, 2 * size, rng.uniform(-size, size)), mat));
+        }
+    }
+
+    scene.cam = stress_camera(point3(0, 3, spread + 10), point3(0, 0, 0), 60);
+    return scene;
+}
+
+/**
+ * A closed box of mirrors around the camera with count spheres floating inside. No ray
+ * can escape and reflections barely fade, so every path runs to the camera's bounce limit.
+ */
+inline stress_scene hall_of_mirrors(long count, std::uint64_t seed) {
+    stress_scene scene;
+    scene_rng rng(seed);
+    scene_arena arena;
+    auto palette = random_palette(rng, 8, 0.5);
+    set_stress_lighting(scene.world);
+    scene.world.set_ambient_light(color(0.6, 0.6, 0.6));
+    scene.world.objects.reserve(size_t(count) + 12);
+
+    auto mirror = random_palette(rng, 1, 0.95)[0];
+    mirror->diffuse_color = color(0.8, 0.85, 0.9);
+
+    /** Two triangles per face of the cube [-2, 2]^3 */
+    const double h = 2.0;
+    point3 corner[8];
+    for (int k = 0; k < 8; k++)
+        corner[k] = point3((k & 1) ? h : -h, (k & 2) ? h : -h, (k & 4) ? h : -h);
+    const int faces[6][4] = {{0, 1, 3, 2}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 2, 6, 4}, {1, 3, 7, 5}};
+    for (const auto& f : faces) {
+        scene.world.add(arena.make<triangle>(corner[f[0]], corner[f[1]], corner[f[2]], mirror));
+        scene.world.add(arena.make<triangle>(corner[f[0]], corner[f[2]], corner[f[3]], mirror));
+    }
+
+    for (long n = 0; n < count; n++) {
+        point3 center = rng.in_box(1.2);
+        double radius = rng.uniform(0.1, 0.3);
+        auto mat = palette[rng.next() % palette.size()];
+        scene.world.add(arena.make<sphere>(center, radius, mat));
+    }
+
+    scene.cam = stress_camera(point3(0, 0, 1.8), point3(0, 0, 0), 75);
+    return scene;
+}
+
+#endif
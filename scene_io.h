@@ -0,0 +1,243 @@
+#ifndef SCENE_IO_H
+#define SCENE_IO_H
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rtmath.h"
+#include "camera.h"
+#include "hittable_list.h"
+#include "sphere.h"
+#include "triangle.h"
+
+/**
+ * Plain text form of a world and camera, one record per line:
+ *
+ *   light_direction x y z
+ *   light_color r g b
+ *   ambient_light r g b
+ *   background_color r g b
+ *   material id kd dr dg db ks sr sg sb ka glossiness reflection
+ *   sphere cx cy cz radius material_id
+ *   triangle ax ay az bx by bz cx cy cz material_id
+ *   camera aspect_ratio image_width fx fy fz ax ay az ux uy uz vfov samples_per_pixel
+ *          max_depth termination output_bits roulette_depth
+ *   end
+ *
+ * The camera's termination is 0 for depth, 1 for output_cutoff, 2 for russian_roulette.
+ * Doubles are written with 17 significant digits so they read back bit-exact, which keeps
+ * renders of a loaded scene identical to renders of the original. Materials shared by
+ * several objects stay shared. Lines that a reader doesn't know are rejected.
+ */
+
+/** Writes the world and camera. Returns false if the world holds a type with no text form. */
+inline bool write_scene(std::ostream& out, const hittable_list& world, const camera& cam) {
+    std::ostream::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::setprecision(17);
+
+    out << "light_direction " << world.get_light_direction() << '\n';
+    out << "light_color " << world.get_light_color() << '\n';
+    out << "ambient_light " << world.get_ambient_light() << '\n';
+    out << "background_color " << world.get_background_color() << '\n';
+
+    std::map<const material*, int> material_ids;
+    auto material_id = [&](const shared_ptr<material>& mat) {
+        auto found = material_ids.find(mat.get());
+        if (found != material_ids.end()) return found->second;
+
+        int id = int(material_ids.size());
+        material_ids[mat.get()] = id;
+        out << "material " << id << ' '
+            << mat->diffuse_ref_coef << ' ' << mat->diffuse_color << ' '
+            << mat->specular_ref_coef << ' ' << mat->specular_highlight_color << ' '
+            << mat->ambient_ref_coef << ' ' << mat->glossiness << ' '
+            << mat->reflection_factor << '\n';
+        return id;
+    };
+
+    bool ok = true;
+    for (const auto& object : world.objects) {
+        if (auto s = std::dynamic_pointer_cast<sphere>(object)) {
+            int id = material_id(s->get_material());
+            out << "sphere " << s->get_center() << ' ' << s->get_radius() << ' ' << id << '\n';
+        } else if (auto t = std::dynamic_pointer_cast<triangle>(object)) {
+            int id = material_id(t->get_material());
+            out << "triangle " << t->get_a() << ' ' << t->get_b() << ' ' << t->get_c() << ' ' << id << '\n';
+        } else {
+            ok = false;
+        }
+    }
+
+    out << "camera " << cam.aspect_ratio << ' ' << cam.image_width << ' '
+        << cam.look_from << ' ' << cam.look_at << ' ' << cam.look_up << ' '
+        << cam.vfov << ' ' << cam.samples_per_pixel << ' ' << cam.max_depth << ' '
+        << int(cam.termination) << ' ' << cam.output_bits << ' ' << cam.roulette_depth << '\n';
+    out << "end\n";
+
+    out.flags(flags);
+    out.precision(precision);
+    return ok;
+}
+
+inline std::string scene_to_string(const hittable_list& world, const camera& cam) {
+    std::ostringstream out;
+    write_scene(out, world, cam);
+    return out.str();
+}
+
+/**
+ * Largest image edge and pixel count, in pixels, sample count and path length a camera
+ * record may ask for. The defaults bound what an untrusted client can make a server
+ * allocate and trace; their pixel cap keeps the framebuffer under a gigabyte. none() only
+ * keeps the image height within an int, for scenes from a trusted source.
+ */
+struct scene_limits {
+    int max_image_side = 32768;
+    long long max_image_pixels = 1LL << 25;
+    int max_samples_per_pixel = 1 << 16;
+    int max_trace_depth = 1000;
+
+    static scene_limits none() {
+        int most = std::numeric_limits<int>::max();
+        return {most, std::numeric_limits<long long>::max(), most, most};
+    }
+};
+
+/**
+ * Checks that cam describes an image that can be rendered: positive finite sizes within
+ * limits, a finite camera that looks somewhere and has an up direction, a field of view
+ * between 0 and 180 degrees and at least one sample and one ray per path. Returns false
+ * and sets error otherwise.
+ */
+inline bool validate_camera(const camera& cam, std::string& error,
+                            const scene_limits& limits = scene_limits()) {
+    auto finite = [](const vec3& v) {
+        return std::isfinite(v.x()) && std::isfinite(v.y()) && std::isfinite(v.z());
+    };
+    // Zero, or so short or long that normalizing it gives NaN
+    auto degenerate = [](const vec3& v) {
+        return !(v.length_squared() > 0) || !std::isfinite(v.length_squared());
+    };
+
+    if (!(cam.aspect_ratio > 0) || !std::isfinite(cam.aspect_ratio))
+        error = "aspect ratio must be positive";
+    else if (cam.image_width < 1 || cam.image_width > limits.max_image_side)
+        error = "image width must be between 1 and " + std::to_string(limits.max_image_side);
+    else if (cam.image_width / cam.aspect_ratio > limits.max_image_side)
+        error = "image height must be at most " + std::to_string(limits.max_image_side);
+    else if (cam.image_width * std::max(1.0, std::floor(cam.image_width / cam.aspect_ratio))
+             > double(limits.max_image_pixels))
+        error = "image must have at most " + std::to_string(limits.max_image_pixels) + " pixels";
+    else if (!finite(cam.look_from) || !finite(cam.look_at) || !finite(cam.look_up))
+        error = "camera position, target and up direction must be finite";
+    else if (degenerate(cam.look_from - cam.look_at))
+        error = "camera position and target must differ";
+    else if (degenerate(cam.look_up))
+        error = "camera up direction must not be zero";
+    else if (!(cam.vfov > 0 && cam.vfov < 180))
+        error = "vertical field of view must be between 0 and 180 degrees";
+    else if (cam.samples_per_pixel < 1 || cam.samples_per_pixel > limits.max_samples_per_pixel)
+        error = "samples per pixel must be between 1 and " + std::to_string(limits.max_samples_per_pixel);
+    else if (cam.max_depth < 1 || cam.max_depth > limits.max_trace_depth)
+        error = "max depth must be between 1 and " + std::to_string(limits.max_trace_depth);
+    else if (cam.output_bits < 1 || cam.output_bits > max_output_bits)
+        error = "output bits must be between 1 and " + std::to_string(max_output_bits);
+    else if (cam.roulette_depth < 0)
+        error = "roulette depth must not be negative";
+    else
+        return true;
+    return false;
+}
+
+/**
+ * Reads records up to and including "end" into world and cam. On failure returns false
+ * and describes the offending line in error. A scene must have one camera record, and
+ * its settings must pass validate_camera with limits.
+ */
+inline bool read_scene(std::istream& in, hittable_list& world, camera& cam, std::string& error,
+                       const scene_limits& limits = scene_limits()) {
+    std::map<int, shared_ptr<material>> materials;
+    std::string line;
+    int line_number = 0;
+    bool have_camera = false;
+
+    auto read_vec = [](std::istream& fields, vec3& v) {
+        return bool(fields >> v.e[0] >> v.e[1] >> v.e[2]);
+    };
+
+    while (std::getline(in, line)) {
+        line_number++;
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind)) continue;
+        if (kind == "end") {
+            if (have_camera) return true;
+            error = "missing 'camera' record";
+            return false;
+        }
+
+        bool ok = false;
+        vec3 v;
+        if (kind == "light_direction") {
+            // Already normalized when written, so don't normalize it again and risk the last bit
+            if ((ok = read_vec(fields, v))) world.set_light_direction(v, false);
+        } else if (kind == "light_color") {
+            if ((ok = read_vec(fields, v))) world.set_light_color(v);
+        } else if (kind == "ambient_light") {
+            if ((ok = read_vec(fields, v))) world.set_ambient_light(v);
+        } else if (kind == "background_color") {
+            if ((ok = read_vec(fields, v))) world.set_background_color(v);
+        } else if (kind == "material") {
+            int id;
+            auto mat = make_shared<material>();
+            ok = fields >> id >> mat->diffuse_ref_coef && read_vec(fields, mat->diffuse_color)
+              && fields >> mat->specular_ref_coef && read_vec(fields, mat->specular_highlight_color)
+              && fields >> mat->ambient_ref_coef >> mat->glossiness >> mat->reflection_factor;
+            if (ok) materials[id] = mat;
+        } else if (kind == "sphere") {
+            point3 center;
+            double radius;
+            int id;
+            ok = read_vec(fields, center) && fields >> radius >> id && materials.count(id);
+            if (ok) world.add(make_shared<sphere>(center, radius, materials[id]));
+        } else if (kind == "triangle") {
+            point3 a, b, c;
+            int id;
+            ok = read_vec(fields, a) && read_vec(fields, b) && read_vec(fields, c)
+              && fields >> id && materials.count(id);
+            if (ok) world.add(make_shared<triangle>(a, b, c, materials[id]));
+        } else if (kind == "camera") {
+            ok = fields >> cam.aspect_ratio >> cam.image_width && read_vec(fields, cam.look_from)
+              && read_vec(fields, cam.look_at) && read_vec(fields, cam.look_up)
+              && fields >> cam.vfov >> cam.samples_per_pixel >> cam.max_depth;
+            int termination;
+            ok = ok && fields >> termination >> cam.output_bits >> cam.roulette_depth
+              && termination >= 0 && termination <= int(termination_policy::russian_roulette);
+            if (ok) cam.termination = termination_policy(termination);
+
+            std::string problem;
+            if (ok && !validate_camera(cam, problem, limits)) {
+                error = "line " + std::to_string(line_number) + ": " + problem;
+                return false;
+            }
+            have_camera = ok;
+        }
+
+        if (!ok) {
+            error = "line " + std::to_string(line_number) + ": bad record '" + line + "'";
+            return false;
+        }
+    }
+
+    error = "missing 'end' record";
+    return false;
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef SOCKET_IO_H
+#define SOCKET_IO_H
+
+#include <string>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/** Blocking stream socket helpers (POSIX only) for the render server and distributed rendering. */
+namespace socket_io {
+    inline bool send_all(int fd, const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t sent = ::send(fd, bytes, size, MSG_NOSIGNAL);
+            if (sent <= 0) return false;
+            bytes += sent;
+            size -= size_t(sent);
+        }
+        return true;
+    }
+
+    inline bool recv_all(int fd, void* data, size_t size) {
+        char* bytes = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t got = ::recv(fd, bytes, size, 0);
+            if (got <= 0) return false;
+            bytes += got;
+            size -= size_t(got);
+        }
+        return true;
+    }
+
+    /**
+     * Reads one '\n' terminated line, without the terminator. Byte at a time; requests are
+     * small. Fails on a line longer than max_length.
+     */
+    inline bool recv_line(int fd, std::string& line, size_t max_length = std::string::npos) {
+        line.clear();
+        char c;
+        while (::recv(fd, &c, 1, 0) == 1) {
+            if (c == '\n') return true;
+            if (line.size() == max_length) return false;
+            line += c;
+        }
+        return false;
+    }
+
+    inline bool make_address(const std::string& path, sockaddr_un& address) {
+        if (path.size() >= sizeof(address.sun_path)) return false;
+        address = sockaddr_un{};
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, path.size());
+        return true;
+    }
+
+    /** Sends small messages right away; request/reply traffic otherwise stalls on Nagle's algorithm. */
+    inline void set_no_delay(int fd) {
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    /** Makes blocking receives on fd fail after seconds without data, 0 = wait forever. */
+    inline void set_receive_timeout(int fd, double seconds) {
+        timeval timeout{};
+        timeout.tv_sec = time_t(seconds);
+        timeout.tv_usec = suseconds_t((seconds - double(timeout.tv_sec)) * 1e6);
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    /** Connects to host:port over TCP. Returns the socket, or -1. */
+    inline int connect_tcp(const std::string& host, int port) {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = nullptr;
+        if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0) return -1;
+
+        int fd = -1;
+        for (addrinfo* a = found; a && fd < 0; a = a->ai_next) {
+            fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        ::freeaddrinfo(found);
+        if (fd >= 0) set_no_delay(fd);
+        return fd;
+    }
+
+    /** Listens on port on every IPv4 interface. Returns the socket, or -1. */
+    inline int listen_tcp(int port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+
+        int reuse = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(uint16_t(port));
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, 4) < 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+}
+
+#endif
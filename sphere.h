@@ -39,7 +39,16 @@ class sphere : public hittable {
             return true;
         }
 
+        aabb bounding_box() const override {
+            vec3 extent(radius, radius, radius);
+            return aabb(center - extent, center + extent);
+        }
+
         shared_ptr<material> get_material() const { return mat; }
+        const point3& get_center() const { return center; }
+        /** Moves the sphere. Rebuild any accelerator holding it before the next render. */
+        void set_center(const point3& center) { this->center = center; }
+        double get_radius() const { return radius; }
 
     private: 
         point3 center;
@@ -0,0 +1,120 @@
+#ifndef STRIPE_RENDER_H
+#define STRIPE_RENDER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+#include "hittable_list.h"
+#include "image_encoder.h"
+#include "thread_pool.h"
+
+struct stripe_options {
+    int stripe_height = 16;  // Image rows per stripe
+    int threads = 0;         // Worker threads, 0 = one per hardware thread
+    int reorder_limit = 0;   // Stripes rendered ahead of the writer, 0 = twice the threads
+};
+
+/**
+ * Streams an image of any size to out with bounded memory. Workers render horizontal
+ * stripes in parallel, quantize and encode them, and park them in a reorder buffer; the
+ * calling thread appends them to out in order and frees them. A worker never starts a
+ * stripe more than reorder_limit stripes ahead of the writer, so peak memory depends on
+ * the stripe size and thread count, never on the image height.
+ *
+ * out can be a file or std::cout, to pipe the image into other tools. Colors above 1 are
+ * clamped to 255. Returns false if writing to out failed.
+ */
+inline bool render_stripes(camera cam, const hittable_list& world, std::ostream& out,
+                           image_encoder& encoder, const stripe_options& options = stripe_options()) {
+    cam.initialize();
+    const int width = cam.image_width;
+    const int height = cam.get_image_height();
+    const int stripe_height = std::max(1, options.stripe_height);
+    const int stripe_count = (height + stripe_height - 1) / stripe_height;
+    const int thread_count = resolve_thread_count(options.threads);
+    const int window = options.reorder_limit > 0 ? options.reorder_limit : 2 * thread_count;
+
+    std::string header = encoder.begin(width, height, stripe_height);
+    out.write(header.data(), std::streamsize(header.size()));
+
+    std::mutex mtx;
+    std::condition_variable stripe_ready, slot_free;
+    std::vector<std::string> slots(window);      // Encoded stripe k waits in slots[k % window]
+    std::vector<char> filled(window, 0);
+    int next_stripe = 0;                         // Next stripe a worker will claim
+    int next_to_write = 0;                       // Next stripe the writer appends
+    bool failed = !out;
+
+    auto worker = [&]() {
+        std::vector<unsigned char> rgb;
+        std::vector<const hittable*> candidates;
+        for (;;) {
+            int k;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                slot_free.wait(lock, [&] { return failed || next_stripe < next_to_write + window; });
+                if (failed || next_stripe >= stripe_count) return;
+                k = next_stripe++;
+            }
+
+            int y0 = k * stripe_height;
+            int rows = std::min(stripe_height, height - y0);
+            rgb.clear();
+            const auto* primary = cam.primary_candidates(world, {0, y0, width, y0 + rows}, candidates) ? &candidates : nullptr;
+            for (int j = y0; j < y0 + rows; j++) {
+                for (int i = 0; i < width; i++) {
+                    color pixel = cam.pixel_color(world, i, j, primary);
+                    rgb.push_back(color_to_byte(pixel.x()));
+                    rgb.push_back(color_to_byte(pixel.y()));
+                    rgb.push_back(color_to_byte(pixel.z()));
+                }
+            }
+            std::string encoded = encoder.encode_stripe(k, rgb.data(), rows);
+
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                slots[k % window] = std::move(encoded);
+                filled[k % window] = 1;
+            }
+            stripe_ready.notify_one();
+        }
+    };
+
+    thread_pool pool(thread_count);
+    for (int t = 0; t < thread_count; t++)
+        pool.submit(worker);
+
+    for (int k = 0; k < stripe_count && !failed; k++) {
+        std::string encoded;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            stripe_ready.wait(lock, [&] { return filled[k % window] != 0; });
+            encoded.swap(slots[k % window]);
+            filled[k % window] = 0;
+        }
+
+        out.write(encoded.data(), std::streamsize(encoded.size()));
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            next_to_write++;
+            if (!out) failed = true;
+        }
+        slot_free.notify_all();
+    }
+
+    pool.wait_idle();
+
+    if (failed) return false;
+    std::string trailer = encoder.finish();
+    out.write(trailer.data(), std::streamsize(trailer.size()));
+    out.flush();
+    return bool(out);
+}
+
+#endif
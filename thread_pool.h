@@ -0,0 +1,102 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/** Worker count for a threads option: itself if positive, else one per hardware thread. */
+inline int resolve_thread_count(int threads) {
+    return threads > 0 ? threads : int(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+/**
+ * Fixed set of worker threads draining one task queue. Shared by everything that renders
+ * in parallel so several images can keep the same cores busy. Higher priority tasks run
+ * first; tasks of equal priority run in submission order.
+ */
+class thread_pool {
+    public:
+        /** threads <= 0 means one worker per hardware thread. */
+        explicit thread_pool(int threads = 0) {
+            int count = resolve_thread_count(threads);
+            for (int t = 0; t < count; t++)
+                workers.emplace_back([this] { work(); });
+        }
+
+        /** Finishes every queued task before returning. */
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                stopping = true;
+            }
+            task_ready.notify_all();
+            for (auto& w : workers)
+                w.join();
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        int size() const { return int(workers.size()); }
+
+        void submit(std::function<void()> task, int priority = 0) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                tasks.push({priority, next_sequence++, std::move(task)});
+            }
+            task_ready.notify_one();
+        }
+
+        /** Blocks until the queue is empty and no task is running. */
+        void wait_idle() {
+            std::unique_lock<std::mutex> lock(mtx);
+            idle.wait(lock, [this] { return tasks.empty() && running == 0; });
+        }
+
+    private:
+        struct queued_task {
+            int priority;
+            unsigned long long sequence;
+            std::function<void()> run;
+
+            bool operator<(const queued_task& other) const {
+                if (priority != other.priority) return priority < other.priority;
+                return sequence > other.sequence;
+            }
+        };
+
+        std::vector<std::thread> workers;
+        std::priority_queue<queued_task> tasks;
+        unsigned long long next_sequence = 0;
+        std::mutex mtx;
+        std::condition_variable task_ready;
+        std::condition_variable idle;
+        int running = 0;         // Tasks currently executing
+        bool stopping = false;
+
+        void work() {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    task_ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+                    if (tasks.empty()) return;
+                    task = std::move(const_cast<queued_task&>(tasks.top()).run);
+                    tasks.pop();
+                    running++;
+                }
+
+                task();
+
+                std::lock_guard<std::mutex> lock(mtx);
+                if (--running == 0 && tasks.empty()) idle.notify_all();
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef TILE_H
+#define TILE_H
+
+#include <algorithm>
+#include <vector>
+
+/** Rectangle of pixels [x0, x1) x [y0, y1), the unit of parallel work. */
+struct tile {
+    int x0, y0, x1, y1;
+
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+};
+
+/** Cuts a width x height image into tiles of at most size x size, in scanline order. */
+inline std::vector<tile> make_tiles(int width, int height, int size) {
+    std::vector<tile> tiles;
+    for (int y = 0; y < height; y += size)
+        for (int x = 0; x < width; x += size)
+            tiles.push_back({x, y, std::min(x + size, width), std::min(y + size, height)});
+    return tiles;
+}
+
+#endif
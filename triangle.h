@@ -53,7 +53,14 @@ class triangle : public hittable {
             return true;
         }
 
+        aabb bounding_box() const override {
+            return aabb(aabb(a, b), aabb(c, c));
+        }
+
         shared_ptr<material> get_material() const { return mat; }
+        const point3& get_a() const { return a; }
+        const point3& get_b() const { return b; }
+        const point3& get_c() const { return c; }
 
     private:
         point3 a, b, c;
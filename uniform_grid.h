@@ -0,0 +1,317 @@
+#ifndef UNIFORM_GRID_H
+#define UNIFORM_GRID_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "rtmath.h"
+#include "aabb.h"
+#include "hittable.h"
+#include "thread_pool.h"
+
+struct grid_options {
+    double cells_per_object = 2.0;  // Target cell count relative to the number of gridded objects
+    int max_resolution = 1024;      // Cap on cells along each axis
+    double huge_factor = 64.0;      // Objects this many times the typical size are kept out of the grid
+    int threads = 0;                // Build threads, 0 = one per hardware thread
+};
+
+/**
+ * Uniform grid over a fixed set of objects, for scenes of very many small, similarly sized
+ * objects that move from frame to frame, where rebuilding a tree would cost more than it
+ * saves. Both (re)building and memory are linear in the object count.
+ *
+ * The resolution is picked so there are about cells_per_object cells per object, cubic
+ * where the bounds allow. Building is a parallel counting sort: count the objects
+ * overlapping each cell, prefix-sum the counts into offsets, then scatter object indices
+ * into one flat array. Rays walk the cells they pass through in order with 3D-DDA and stop
+ * once the nearest hit so far lies before the end of the current cell.
+ *
+ * Objects without a finite bounding box, and ones much larger than typical (a ground
+ * plane, say), would flood the grid with references; they are tested on every ray instead.
+ *
+ * Hits are exactly those of testing every object in order, ties included (the earliest
+ * object wins), so a grid never changes a render.
+ */
+class uniform_grid : public hittable {
+    public:
+        /** Grids the given objects, which must outlive the grid. */
+        uniform_grid(const std::vector<shared_ptr<hittable>>& objects, const grid_options& options = grid_options())
+            : options(options) {
+            primitives.reserve(objects.size());
+            for (const auto& object : objects)
+                primitives.push_back(object.get());
+            rebuild();
+        }
+
+        /** Re-reads every object's bounding box and regrids them, e.g. after they have moved. */
+        void rebuild() {
+            size_t count = primitives.size();
+            int thread_count = resolve_thread_count(options.threads);
+            thread_count = int(std::min<size_t>(thread_count, std::max<size_t>(1, count / 4096)));
+
+            boxes.resize(count);
+            parallel_for(count, thread_count, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; k++)
+                    boxes[k] = primitives[k]->bounding_box();
+            });
+
+            /** Typical object size, the median diagonal of a sample of the finite boxes */
+            std::vector<double> sizes;
+            size_t stride = std::max<size_t>(1, count / 1024);
+            for (size_t k = 0; k < count; k += stride)
+                if (boxes[k].is_finite()) sizes.push_back(boxes[k].diagonal().length());
+            double huge_size = infinity;
+            if (!sizes.empty()) {
+                std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2, sizes.end());
+                huge_size = options.huge_factor * std::max(sizes[sizes.size() / 2], 1e-12);
+            }
+
+            /** Split off the unbounded and huge objects and find the bounds of the rest, chunk by chunk */
+            std::vector<std::vector<std::uint32_t>> chunk_separate(thread_count);
+            std::vector<aabb> chunk_bounds(thread_count, aabb::empty);
+            std::vector<char> gridded(count);
+            parallel_for(count, thread_count, [&](size_t begin, size_t end, int chunk) {
+                for (size_t k = begin; k < end; k++) {
+                    gridded[k] = boxes[k].is_finite() && !boxes[k].is_empty()
+                              && boxes[k].diagonal().length() <= huge_size;
+                    if (gridded[k]) chunk_bounds[chunk] = aabb(chunk_bounds[chunk], boxes[k]);
+                    else if (!boxes[k].is_empty()) chunk_separate[chunk].push_back(std::uint32_t(k));
+                }
+            });
+            separate.clear();
+            bounds = aabb::empty;
+            for (int chunk = 0; chunk < thread_count; chunk++) {
+                separate.insert(separate.end(), chunk_separate[chunk].begin(), chunk_separate[chunk].end());
+                bounds = aabb(bounds, chunk_bounds[chunk]);
+            }
+            size_t gridded_count = count - separate.size();
+
+            choose_resolution(gridded_count);
+            size_t cell_count = size_t(resolution[0]) * resolution[1] * resolution[2];
+
+            /** Counting sort of the object references by cell */
+            std::vector<std::atomic<std::uint32_t>> counts(cell_count);
+            for_each_gridded(gridded, thread_count, [&](std::uint32_t, size_t cell) {
+                counts[cell].fetch_add(1, std::memory_order_relaxed);
+            });
+
+            cell_start.resize(cell_count + 1);
+            std::uint32_t total = 0;
+            for (size_t cell = 0; cell < cell_count; cell++) {
+                cell_start[cell] = total;
+                total += counts[cell].load(std::memory_order_relaxed);
+                counts[cell].store(cell_start[cell], std::memory_order_relaxed);
+            }
+            cell_start[cell_count] = total;
+
+            cell_objects.resize(total);
+            for_each_gridded(gridded, thread_count, [&](std::uint32_t k, size_t cell) {
+                cell_objects[counts[cell].fetch_add(1, std::memory_order_relaxed)] = k;
+            });
+        }
+
+        bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+            nearest_hit nearest(ray_t, rec);
+            for (std::uint32_t k : separate)
+                nearest.test(r, k, primitives[k]);
+
+            if (!cell_objects.empty()) {
+                walk(r, ray_t, [&](size_t cell, double t_exit) {
+                    for (std::uint32_t n = cell_start[cell]; n < cell_start[cell + 1]; n++)
+                        nearest.test(r, cell_objects[n], primitives[cell_objects[n]]);
+                    return nearest.found && nearest.t <= t_exit;
+                });
+            }
+            return nearest.found;
+        }
+
+        bool occluded(const ray& r, interval ray_t) const override {
+            for (std::uint32_t k : separate)
+                if (primitives[k]->occluded(r, ray_t)) return true;
+
+            bool blocked = false;
+            if (!cell_objects.empty()) {
+                walk(r, ray_t, [&](size_t cell, double) {
+                    for (std::uint32_t n = cell_start[cell]; n < cell_start[cell + 1] && !blocked; n++)
+                        blocked = primitives[cell_objects[n]]->occluded(r, ray_t);
+                    return blocked;
+                });
+            }
+            return blocked;
+        }
+
+        aabb bounding_box() const override {
+            aabb box = bounds;
+            for (std::uint32_t k : separate)
+                box = aabb(box, boxes[k]);
+            return box;
+        }
+
+        int get_resolution(int axis) const { return resolution[axis]; }
+        size_t separate_count() const { return separate.size(); }
+        size_t reference_count() const { return cell_objects.size(); }
+
+    private:
+        grid_options options;
+        std::vector<const hittable*> primitives;    // The objects, in the order given
+        std::vector<aabb> boxes;                    // Their bounding boxes as of the last rebuild
+        std::vector<std::uint32_t> separate;        // Objects tested on every ray, in order
+        aabb bounds;                                // Bounds of the gridded objects
+        int resolution[3] = {1, 1, 1};              // Cells per axis
+        vec3 cell_size, inverse_cell_size;
+        std::vector<std::uint32_t> cell_start;      // Cell c holds cell_objects[cell_start[c] .. cell_start[c + 1])
+        std::vector<std::uint32_t> cell_objects;    // Object indices, grouped by cell
+
+        /** Keeps the nearest hit, and on equal distances the earliest object, like hittable_list::hit. */
+        struct nearest_hit {
+            interval ray_t;
+            hit_record& rec;
+            bool found = false;
+            double t;
+            std::uint32_t index = 0;
+
+            nearest_hit(interval ray_t, hit_record& rec) : ray_t(ray_t), rec(rec), t(ray_t.max) {}
+
+            void test(const ray& r, std::uint32_t k, const hittable* object) {
+                // Let hits at exactly t through, an earlier object there still wins the tie
+                double limit = found ? std::nextafter(t, infinity) : ray_t.max;
+                hit_record candidate;
+                if (!object->hit(r, interval(ray_t.min, limit), candidate)) return;
+                if (found && (candidate.t > t || (candidate.t == t && k > index))) return;
+                found = true;
+                t = candidate.t;
+                index = k;
+                rec = candidate;
+            }
+        };
+
+        void choose_resolution(size_t gridded_count) {
+            vec3 extent = bounds.is_empty() ? vec3(1, 1, 1) : bounds.diagonal();
+            double longest = std::max({extent[0], extent[1], extent[2], 1e-12});
+            for (int a = 0; a < 3; a++)
+                extent.e[a] = std::max(extent[a], longest * 1e-3);   // Flat scenes still get a volume
+
+            double volume = extent[0] * extent[1] * extent[2];
+            double cells_per_unit = std::cbrt(options.cells_per_object * std::max<size_t>(1, gridded_count) / volume);
+            for (int a = 0; a < 3; a++) {
+                resolution[a] = int(std::clamp(std::ceil(extent[a] * cells_per_unit), 1.0, double(options.max_resolution)));
+                cell_size.e[a] = extent[a] / resolution[a];
+                inverse_cell_size.e[a] = 1.0 / cell_size[a];
+            }
+        }
+
+        /** Cell range an object overlaps on one axis, padded a little so rounding can't drop a cell. */
+        void cell_range(const aabb& box, int a, int& first, int& last) const {
+            const interval& range = box.axis_interval(a);
+            double origin = bounds.axis_interval(a).min;
+            double pad = 1e-6 * cell_size[a];
+            first = std::clamp(int(std::floor((range.min - pad - origin) * inverse_cell_size[a])), 0, resolution[a] - 1);
+            last = std::clamp(int(std::floor((range.max + pad - origin) * inverse_cell_size[a])), 0, resolution[a] - 1);
+        }
+
+        /** Calls visit(object, cell) for every cell each gridded object overlaps. */
+        template <typename Visit>
+        void for_each_gridded(const std::vector<char>& gridded, int thread_count, Visit visit) const {
+            parallel_for(primitives.size(), thread_count, [&](size_t begin, size_t end) {
+                for (size_t k = begin; k < end; k++) {
+                    if (!gridded[k]) continue;
+                    int lo[3], hi[3];
+                    for (int a = 0; a < 3; a++)
+                        cell_range(boxes[k], a, lo[a], hi[a]);
+                    for (int z = lo[2]; z <= hi[2]; z++)
+                        for (int y = lo[1]; y <= hi[1]; y++)
+                            for (int x = lo[0]; x <= hi[0]; x++)
+                                visit(std::uint32_t(k), cell_index(x, y, z));
+                }
+            });
+        }
+
+        size_t cell_index(int x, int y, int z) const {
+            return (size_t(z) * resolution[1] + y) * resolution[0] + x;
+        }
+
+        /**
+         * 3D-DDA (Amanatides & Woo): calls visit(cell, t_exit) for each cell r passes
+         * through within ray_t, nearest first, until visit returns true.
+         */
+        template <typename Visit>
+        void walk(const ray& r, interval ray_t, Visit visit) const {
+            const point3& origin = r.origin();
+            const vec3& direction = r.direction();
+
+            /** Clip the ray to the grid bounds */
+            double t_min = ray_t.min, t_max = ray_t.max;
+            for (int a = 0; a < 3; a++) {
+                const interval& slab = bounds.axis_interval(a);
+                if (direction[a] == 0) {
+                    if (origin[a] < slab.min || origin[a] > slab.max) return;
+                    continue;
+                }
+                double inverse = 1.0 / direction[a];
+                double t0 = (slab.min - origin[a]) * inverse;
+                double t1 = (slab.max - origin[a]) * inverse;
+                if (inverse < 0) std::swap(t0, t1);
+                t_min = std::max(t_min, t0);
+                t_max = std::min(t_max, t1);
+                if (t_min > t_max) return;
+            }
+
+            point3 entry = r.at(t_min);
+            int cell[3], step[3];
+            double t_next[3], t_delta[3];
+            for (int a = 0; a < 3; a++) {
+                double low = bounds.axis_interval(a).min;
+                cell[a] = std::clamp(int(std::floor((entry[a] - low) * inverse_cell_size[a])), 0, resolution[a] - 1);
+                if (direction[a] > 0) {
+                    step[a] = 1;
+                    t_next[a] = (low + (cell[a] + 1) * cell_size[a] - origin[a]) / direction[a];
+                    t_delta[a] = cell_size[a] / direction[a];
+                } else if (direction[a] < 0) {
+                    step[a] = -1;
+                    t_next[a] = (low + cell[a] * cell_size[a] - origin[a]) / direction[a];
+                    t_delta[a] = -cell_size[a] / direction[a];
+                } else {
+                    step[a] = 0;
+                    t_next[a] = infinity;
+                    t_delta[a] = infinity;
+                }
+            }
+
+            for (;;) {
+                int a = (t_next[0] < t_next[1]) ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+                if (visit(cell_index(cell[0], cell[1], cell[2]), t_next[a])) return;
+                if (t_next[a] > t_max) return;
+                cell[a] += step[a];
+                if (cell[a] < 0 || cell[a] >= resolution[a]) return;
+                t_next[a] += t_delta[a];
+            }
+        }
+
+        /** Splits [0, count) into thread_count contiguous chunks and runs body on each. */
+        template <typename Body>
+        static void parallel_for(size_t count, int thread_count, Body body) {
+            auto run = [&](int chunk) {
+                size_t begin = count * chunk / thread_count, end = count * (chunk + 1) / thread_count;
+                if constexpr (std::is_invocable_v<Body, size_t, size_t, int>) body(begin, end, chunk);
+                else body(begin, end);
+            };
+            if (thread_count <= 1) {
+                run(0);
+                return;
+            }
+            std::vector<std::thread> threads;
+            for (int chunk = 1; chunk < thread_count; chunk++)
+                threads.emplace_back(run, chunk);
+            run(0);
+            for (auto& t : threads)
+                t.join();
+        }
+};
+
+#endif